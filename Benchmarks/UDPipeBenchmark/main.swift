@@ -0,0 +1,199 @@
+// Throughput and latency benchmark for the Swift API.
+//
+//   swift run -c release UDPipeBenchmark --model english.udpipe --corpus news.txt
+//       [--corpus more.txt] [--iterations 5] [--threads 1,2,4,8]
+//
+// Corpus files hold one document per line. Besides the Swift calls themselves, each
+// single-document mode is also timed through the C API, and the difference is reported as
+// the cost of converting results into Swift values. Results are printed as JSON to stdout.
+
+import UDPipe
+import UDPipeCLib
+#if canImport(Darwin)
+import Darwin
+#elseif canImport(Glibc)
+import Glibc
+#endif
+
+struct Options {
+    var model = ""
+    var corpora: [String] = []
+    var iterations = 5
+    var threads = [1, 2, 4, 8]
+}
+
+struct Result {
+    var name: String
+    var threads = 1
+    var documents = 0
+    var tokens = 0
+    var seconds = 0.0
+    var latenciesMicros: [Double] = []
+}
+
+func now() -> Double {
+    var ts = timespec()
+    clock_gettime(CLOCK_MONOTONIC, &ts)
+    return Double(ts.tv_sec) * 1e6 + Double(ts.tv_nsec) / 1e3
+}
+
+func percentile(_ values: [Double], _ q: Double) -> Double {
+    guard !values.isEmpty else { return 0 }
+    let sorted = values.sorted()
+    return sorted[min(sorted.count - 1, Int(q * Double(sorted.count)))]
+}
+
+func fail(_ message: String) -> Never {
+    fputs(message + "\n", stderr)
+    exit(1)
+}
+
+func parseOptions() -> Options? {
+    var opts = Options()
+    var args = CommandLine.arguments.dropFirst()
+    while let arg = args.popFirst() {
+        guard let value = args.popFirst() else { return nil }
+        switch arg {
+        case "--model": opts.model = value
+        case "--corpus": opts.corpora.append(value)
+        case "--iterations": opts.iterations = max(1, Int(value) ?? 1)
+        case "--threads": opts.threads = value.split(separator: ",").compactMap { Int($0) }.filter { $0 > 0 }
+        default: return nil
+        }
+    }
+    return opts.model.isEmpty || opts.corpora.isEmpty || opts.threads.isEmpty ? nil : opts
+}
+
+func readCorpus(_ path: String) -> [String] {
+    guard let file = fopen(path, "r") else { fail("cannot read corpus \(path)") }
+    defer { fclose(file) }
+    var docs: [String] = []
+    var line: UnsafeMutablePointer<CChar>? = nil
+    var capacity = 0
+    defer { free(line) }
+    while getline(&line, &capacity, file) > 0 {
+        var doc = String(cString: line!)
+        while doc.last == "\n" || doc.last == "\r" { doc.removeLast() }
+        if !doc.isEmpty { docs.append(doc) }
+    }
+    return docs
+}
+
+/// Times `body` once per document and iteration; `body` returns the number of tokens.
+func runSingle(_ name: String, _ docs: [String], _ iterations: Int, _ body: (String) -> Int) -> Result {
+    var r = Result(name: name)
+    r.latenciesMicros.reserveCapacity(docs.count * iterations)
+    for _ in 0..<iterations {
+        for text in docs {
+            let start = now()
+            let tokens = body(text)
+            let us = now() - start
+            r.latenciesMicros.append(us)
+            r.seconds += us / 1e6
+            r.tokens += tokens
+            r.documents += 1
+        }
+    }
+    return r
+}
+
+/// Runs one document through the C API and frees the result, for the conversion baseline.
+func nativeTokens(_ modelHandle: udpipe_model_t, _ text: String, flags: UInt32) -> Int {
+    var text = text
+    return text.withUTF8 { buf in
+        var doc = udpipe_doc_view()
+        let base = UnsafeRawPointer(buf.baseAddress)?.assumingMemoryBound(to: CChar.self)
+        guard udpipe_tag_structured_ex(modelHandle, base, buf.count, flags, &doc) == 1 else { fail("native call failed") }
+        defer { udpipe_doc_recycle(&doc) }
+        return doc.token_count
+    }
+}
+
+func json(_ s: String) -> String {
+    var out = "\""
+    for scalar in s.unicodeScalars {
+        switch scalar {
+        case "\"": out += "\\\""
+        case "\\": out += "\\\\"
+        case _ where scalar.value < 0x20: out += "\\u" + String(repeating: "0", count: 4 - String(scalar.value, radix: 16).count) + String(scalar.value, radix: 16)
+        default: out.unicodeScalars.append(scalar)
+        }
+    }
+    return out + "\""
+}
+
+func format(_ value: Double) -> String {
+    String(Double(Int(value * 10)) / 10)
+}
+
+guard let opts = parseOptions() else {
+    fputs("usage: UDPipeBenchmark --model PATH --corpus FILE [--corpus FILE ...] [--iterations N] [--threads N,N,...]\n", stderr)
+    exit(2)
+}
+let docs = opts.corpora.flatMap(readCorpus)
+if docs.isEmpty { fail("corpus is empty") }
+
+let udpipe: UDPipe
+do {
+    udpipe = try UDPipe(modelPath: opts.model)
+} catch {
+    fail("cannot load model \(opts.model)")
+}
+// The C baseline uses a second handle on the same model file, so both sides start equally warm.
+guard let native = udpipe_model_load(opts.model) else { fail("cannot load model \(opts.model)") }
+defer { udpipe_model_free(native) }
+
+_ = runSingle("warmup", docs, 1) { udpipe.tagTokens($0).reduce(0) { $0 + $1.count } }
+_ = runSingle("warmup", docs, 1) { nativeTokens(native, $0, flags: UInt32(UDPIPE_STAGE_TAG | UDPIPE_STAGE_PARSE)) }
+
+var results: [Result] = []
+var overheads: [(String, Result, Result)] = []
+
+let tokenize = runSingle("tokenize", docs, opts.iterations) { udpipe.tokenize($0).reduce(0) { $0 + $1.tokens.count } }
+let tokenizeC = runSingle("tokenize", docs, opts.iterations) { nativeTokens(native, $0, flags: 0) }
+let tag = runSingle("tag", docs, opts.iterations) { udpipe.tagTokens($0, doParse: false).reduce(0) { $0 + $1.count } }
+let tagC = runSingle("tag", docs, opts.iterations) { nativeTokens(native, $0, flags: UInt32(UDPIPE_STAGE_TAG)) }
+let tagParse = runSingle("tag_parse", docs, opts.iterations) { udpipe.tagTokens($0, doParse: true).reduce(0) { $0 + $1.count } }
+let tagParseC = runSingle("tag_parse", docs, opts.iterations) {
+    nativeTokens(native, $0, flags: UInt32(UDPIPE_STAGE_TAG | UDPIPE_STAGE_PARSE))
+}
+results += [tokenize, tag, tagParse]
+overheads = [("tokenize", tokenize, tokenizeC), ("tag", tag, tagC), ("tag_parse", tagParse, tagParseC)]
+
+for threads in opts.threads {
+    let pool: UDPipe.WorkerPool
+    do {
+        pool = try UDPipe.WorkerPool(threadCount: threads)
+    } catch {
+        fail("cannot start \(threads) threads")
+    }
+    var r = Result(name: "batch_tag_parse", threads: threads)
+    for _ in 0..<opts.iterations {
+        let start = now()
+        let out = udpipe.tagTokens(batch: docs, doParse: true, pool: pool)
+        let us = now() - start
+        r.latenciesMicros.append(us)
+        r.seconds += us / 1e6
+        r.documents += out.count
+        r.tokens += out.reduce(0) { $0 + $1.reduce(0) { $0 + $1.count } }
+    }
+    results.append(r)
+}
+
+var out = "{\"benchmark\":\"swift\",\"udpipe_version\":\(json(UDPipe.version())),\"model\":\(json(opts.model))"
+out += ",\"documents\":\(docs.count),\"iterations\":\(opts.iterations),\"results\":["
+out += results.map { r in
+    let docsPerSec = r.seconds > 0 ? Double(r.documents) / r.seconds : 0
+    let tokensPerSec = r.seconds > 0 ? Double(r.tokens) / r.seconds : 0
+    return "{\"name\":\(json(r.name)),\"threads\":\(r.threads),\"documents\":\(r.documents),\"tokens\":\(r.tokens)"
+        + ",\"seconds\":\(r.seconds),\"docs_per_sec\":\(format(docsPerSec)),\"tokens_per_sec\":\(format(tokensPerSec))"
+        + ",\"latency_us\":{\"p50\":\(format(percentile(r.latenciesMicros, 0.5))),\"p99\":\(format(percentile(r.latenciesMicros, 0.99)))}}"
+}.joined(separator: ",")
+out += "],\"conversion_overhead\":["
+out += overheads.map { name, swift, c in
+    let perDoc = (swift.seconds - c.seconds) * 1e6 / Double(max(swift.documents, 1))
+    let share = swift.seconds > 0 ? (swift.seconds - c.seconds) / swift.seconds * 100 : 0
+    return "{\"name\":\(json(name)),\"us_per_doc\":\(format(perDoc)),\"percent_of_swift_time\":\(format(share))}"
+}.joined(separator: ",")
+out += "]}"
+print(out)
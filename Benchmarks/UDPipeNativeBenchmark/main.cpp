@@ -0,0 +1,275 @@
+// Throughput and latency benchmark for the C wrapper, without any Swift in the way.
+//
+//   swift run -c release UDPipeNativeBenchmark --model english.udpipe --corpus news.txt
+//       [--corpus more.txt] [--iterations 5] [--threads 1,2,4,8]
+//
+// Corpus files hold one document per line. Results are printed as JSON to stdout.
+
+#include "udpipe_wrapper.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+    std::string model;
+    std::vector<std::string> corpora;
+    size_t iterations = 5;
+    std::vector<size_t> threads = {1, 2, 4, 8};
+};
+
+struct Result {
+    std::string name;
+    size_t threads = 1;
+    size_t nodes = 1;     // NUMA nodes the pool spans
+    size_t documents = 0;
+    size_t tokens = 0;
+    double seconds = 0;
+    std::vector<double> latencies_us; // per call
+};
+
+using Clock = std::chrono::steady_clock;
+
+double elapsed_us(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+double percentile(std::vector<double> values, double q) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t i = std::min(values.size() - 1, static_cast<size_t>(q * values.size()));
+    return values[i];
+}
+
+void usage() {
+    std::fprintf(stderr,
+                 "usage: UDPipeNativeBenchmark --model PATH --corpus FILE [--corpus FILE ...]\n"
+                 "                             [--iterations N] [--threads N,N,...]\n");
+}
+
+bool parse_options(int argc, char** argv, Options& opts) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) return false;
+        std::string value = argv[++i];
+        if (arg == "--model") {
+            opts.model = value;
+        } else if (arg == "--corpus") {
+            opts.corpora.push_back(value);
+        } else if (arg == "--iterations") {
+            opts.iterations = std::max<size_t>(1, std::strtoul(value.c_str(), nullptr, 10));
+        } else if (arg == "--threads") {
+            opts.threads.clear();
+            for (size_t pos = 0; pos < value.size();) {
+                size_t end = value.find(',', pos);
+                if (end == std::string::npos) end = value.size();
+                size_t n = std::strtoul(value.substr(pos, end - pos).c_str(), nullptr, 10);
+                if (n) opts.threads.push_back(n);
+                pos = end + 1;
+            }
+        } else {
+            return false;
+        }
+    }
+    return !opts.model.empty() && !opts.corpora.empty() && !opts.threads.empty();
+}
+
+bool read_corpora(const std::vector<std::string>& paths, std::vector<std::string>& docs) {
+    for (const auto& path : paths) {
+        std::ifstream in(path);
+        if (!in) {
+            std::fprintf(stderr, "cannot read corpus %s\n", path.c_str());
+            return false;
+        }
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty()) docs.push_back(line);
+        }
+    }
+    return !docs.empty();
+}
+
+// Runs every document through `process` one call at a time.
+template <class Process>
+Result run_single(const char* name, const std::vector<std::string>& docs, size_t iterations, Process process) {
+    Result r;
+    r.name = name;
+    r.latencies_us.reserve(docs.size() * iterations);
+    for (size_t it = 0; it < iterations; ++it) {
+        for (const auto& text : docs) {
+            udpipe_doc_view doc{};
+            auto start = Clock::now();
+            if (!process(text, &doc)) {
+                std::fprintf(stderr, "%s failed\n", name);
+                std::exit(1);
+            }
+            double us = elapsed_us(start);
+            r.latencies_us.push_back(us);
+            r.seconds += us / 1e6;
+            r.tokens += doc.token_count;
+            r.documents += 1;
+            udpipe_doc_recycle(&doc);
+        }
+    }
+    return r;
+}
+
+// Runs the whole corpus through one batch call per iteration on `pool`.
+Result run_batch(const char* name, udpipe_model_t model, const std::vector<std::string>& docs, size_t iterations,
+                 udpipe_pool_t pool) {
+    Result r;
+    r.name = name;
+    r.threads = udpipe_pool_size(pool);
+    r.nodes = udpipe_pool_node_count(pool);
+    std::vector<const char*> texts;
+    std::vector<size_t> lens;
+    for (const auto& d : docs) {
+        texts.push_back(d.data());
+        lens.push_back(d.size());
+    }
+    for (size_t it = 0; it < iterations; ++it) {
+        udpipe_doc_view* out = nullptr;
+        size_t out_size = 0;
+        auto start = Clock::now();
+        if (!udpipe_tag_batch_ex(model, pool, texts.data(), lens.data(), texts.size(),
+                                 UDPIPE_STAGE_TAG | UDPIPE_STAGE_PARSE, &out, &out_size)) {
+            std::fprintf(stderr, "batch failed\n");
+            std::exit(1);
+        }
+        double us = elapsed_us(start);
+        r.latencies_us.push_back(us);
+        r.seconds += us / 1e6;
+        for (size_t i = 0; i < out_size; ++i) r.tokens += out[i].token_count;
+        r.documents += out_size;
+        udpipe_batch_recycle(out, out_size);
+    }
+    return r;
+}
+
+void print_json_string(const std::string& s) {
+    std::putchar('"');
+    for (char c : s) {
+        if (c == '"' || c == '\\') std::printf("\\%c", c);
+        else if (static_cast<unsigned char>(c) < 0x20) std::printf("\\u%04x", c);
+        else std::putchar(c);
+    }
+    std::putchar('"');
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opts;
+    if (!parse_options(argc, argv, opts)) {
+        usage();
+        return 2;
+    }
+    std::vector<std::string> docs;
+    if (!read_corpora(opts.corpora, docs)) return 1;
+
+    udpipe_model_t model = udpipe_model_load(opts.model.c_str());
+    if (!model) {
+        std::fprintf(stderr, "cannot load model %s\n", opts.model.c_str());
+        return 1;
+    }
+
+    // Warm up the tokenizer freelist, page cache and tag vocabularies.
+    run_single("warmup", docs, 1, [&](const std::string& t, udpipe_doc_view* d) {
+        return udpipe_tag_structured_ex(model, t.data(), t.size(), UDPIPE_STAGE_TAG | UDPIPE_STAGE_PARSE, d);
+    });
+
+    std::vector<Result> results;
+    results.push_back(run_single("tokenize", docs, opts.iterations, [&](const std::string& t, udpipe_doc_view* d) {
+        return udpipe_tag_structured_ex(model, t.data(), t.size(), 0, d);
+    }));
+    results.push_back(run_single("tag", docs, opts.iterations, [&](const std::string& t, udpipe_doc_view* d) {
+        return udpipe_tag_structured_ex(model, t.data(), t.size(), UDPIPE_STAGE_TAG, d);
+    }));
+    results.push_back(run_single("tag_parse", docs, opts.iterations, [&](const std::string& t, udpipe_doc_view* d) {
+        return udpipe_tag_structured_ex(model, t.data(), t.size(), UDPIPE_STAGE_TAG | UDPIPE_STAGE_PARSE, d);
+    }));
+    // Tagging and parsing requested, but only some fields wanted (compare with tag_parse).
+    const struct {
+        const char* name;
+        unsigned fields;
+    } field_levels[] = {
+        {"fields_upos", UDPIPE_WANT_UPOS},
+        {"fields_upos_lemma", UDPIPE_WANT_UPOS | UDPIPE_WANT_LEMMA},
+        {"fields_upos_deps", UDPIPE_WANT_UPOS | UDPIPE_WANT_DEPS},
+    };
+    for (const auto& level : field_levels) {
+        const unsigned flags = UDPIPE_STAGE_TAG | UDPIPE_STAGE_PARSE | level.fields;
+        results.push_back(run_single(level.name, docs, opts.iterations, [&](const std::string& t, udpipe_doc_view* d) {
+            return udpipe_tag_structured_ex(model, t.data(), t.size(), flags, d);
+        }));
+    }
+    for (size_t threads : opts.threads) {
+        udpipe_pool_t pool = udpipe_pool_create(threads);
+        if (!pool) {
+            std::fprintf(stderr, "cannot start %zu threads\n", threads);
+            return 1;
+        }
+        results.push_back(run_batch("batch_tag_parse", model, docs, opts.iterations, pool));
+        udpipe_pool_free(pool);
+    }
+    // Socket scaling: pinned, NUMA-grouped pools over the first 1, 2, ... nodes, one
+    // worker per CPU. First every node shares the one copy of the model, then each node
+    // gets its own; copies outlive the pool, hence the two rounds.
+    for (bool replicated : {false, true}) {
+        for (size_t nodes = 1; nodes <= udpipe_numa_node_count(); ++nodes) {
+            udpipe_pool_options placement{};
+            placement.max_nodes = nodes;
+            placement.flags = UDPIPE_POOL_NUMA | UDPIPE_POOL_PIN_THREADS;
+            udpipe_pool_t pool = udpipe_pool_create_ex(&placement);
+            if (!pool || (replicated && !udpipe_model_replicate(model, pool))) {
+                std::fprintf(stderr, "cannot set up a pool on %zu NUMA nodes\n", nodes);
+                udpipe_pool_free(pool);
+                return 1;
+            }
+            const char* name = replicated ? "batch_tag_parse_numa" : "batch_tag_parse_numa_shared";
+            results.push_back(run_batch(name, model, docs, opts.iterations, pool));
+            udpipe_pool_free(pool);
+        }
+    }
+    // One document at a time, each spread over the pool.
+    for (size_t threads : opts.threads) {
+        udpipe_pool_t pool = udpipe_pool_create(threads);
+        if (!pool) {
+            std::fprintf(stderr, "cannot start %zu threads\n", threads);
+            return 1;
+        }
+        Result r = run_single("tag_parse_parallel", docs, opts.iterations,
+                              [&](const std::string& t, udpipe_doc_view* d) {
+            return udpipe_tag_structured_parallel(model, pool, t.data(), t.size(),
+                                                  UDPIPE_STAGE_TAG | UDPIPE_STAGE_PARSE, d);
+        });
+        r.threads = threads;
+        results.push_back(std::move(r));
+        udpipe_pool_free(pool);
+    }
+    udpipe_model_free(model);
+
+    std::printf("{\"benchmark\":\"native\",\"udpipe_version\":");
+    print_json_string(udpipe_version());
+    std::printf(",\"model\":");
+    print_json_string(opts.model);
+    std::printf(",\"documents\":%zu,\"iterations\":%zu,\"results\":[", docs.size(), opts.iterations);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        std::printf("%s{\"name\":\"%s\",\"threads\":%zu,\"nodes\":%zu,\"documents\":%zu,\"tokens\":%zu,"
+                    "\"seconds\":%.6f,\"docs_per_sec\":%.1f,\"tokens_per_sec\":%.1f,"
+                    "\"latency_us\":{\"p50\":%.1f,\"p99\":%.1f}}",
+                    i ? "," : "", r.name.c_str(), r.threads, r.nodes, r.documents, r.tokens, r.seconds,
+                    r.seconds > 0 ? r.documents / r.seconds : 0.0, r.seconds > 0 ? r.tokens / r.seconds : 0.0,
+                    percentile(r.latencies_us, 0.50), percentile(r.latencies_us, 0.99));
+    }
+    std::printf("]}\n");
+    return 0;
+}
@@ -1,6 +1,33 @@
 // swift-tools-version: 6.2
 import PackageDescription
 
+// Set UDPIPE_NATIVE_ARCH=1 when building to compile the vendored engine for the build
+// machine's CPU (-march=native), which lets the compiler vectorise the parser and tagger
+// inner loops with AVX2/AVX-512 or the full NEON feature set. Binaries built this way
+// only run on CPUs with the same features. Floating-point contraction stays off, so that
+// the arithmetic matches the portable build; parseOutputMatchesGolden checks the results.
+let nativeArch = Context.environment["UDPIPE_NATIVE_ARCH"].map { $0 == "1" || $0 == "true" } ?? false
+let coreOptimizationFlags = ["-ffp-contract=off"] + (nativeArch ? ["-march=native"] : [])
+// Tells the tests that the engine was built with -O3 or -march=native, so that the golden
+// output is only recorded by the portable build.
+let optimizedCoreSettings: [SwiftSetting] = nativeArch
+    ? [.define("UDPIPE_OPTIMIZED_CORE")]
+    : [.define("UDPIPE_OPTIMIZED_CORE", .when(configuration: .release))]
+
+// Set UDPIPE_STATS=1 to compile in the per-stage timers and counters read by
+// udpipe_stats_snapshot / UDPipe.statistics. Without it they cost nothing.
+let collectStats = Context.environment["UDPIPE_STATS"].map { $0 == "1" || $0 == "true" } ?? false
+let statsSettings: [CXXSetting] = collectStats ? [.define("UDPIPE_STATS")] : []
+
+// Debug builds (and so `swift test`) also compile the test hooks of udpipe_testing.h,
+// such as fault injection. Release builds leave them out entirely.
+let testingCSettings: [CXXSetting] = [.define("UDPIPE_TESTING", .when(configuration: .debug))]
+let testingSwiftSettings: [SwiftSetting] = [
+    .define("UDPIPE_TESTING", .when(configuration: .debug)),
+    // Lets the Clang importer see the declarations guarded by UDPIPE_TESTING.
+    .unsafeFlags(["-Xcc", "-DUDPIPE_TESTING"], .when(configuration: .debug)),
+]
+
 let package = Package(
     name: "swift-udpipe",
     products: [
@@ -108,6 +135,8 @@ let package = Package(
             cxxSettings: [
                 .define("UDPIPE_STATIC"),
                 .unsafeFlags(["-std=c++17"]),
+                .unsafeFlags(coreOptimizationFlags),
+                .unsafeFlags(["-O3"], .when(configuration: .release)),
                 .headerSearchPath("."),
             ],
             linkerSettings: [
@@ -120,14 +149,22 @@ let package = Package(
             dependencies: ["UDPipeCore"],
             path: "Sources/UDPipeCLib",
             sources: [
-                "udpipe_wrapper.cpp"
+                "udpipe_wrapper.cpp",
+                "tag_vocabulary.cpp",
+                "worker_pool.cpp",
+                "model_registry.cpp",
+                "sentence_cache.cpp",
+                "stage_stats.cpp",
+                "binary_format.cpp",
+                "block_pool.cpp",
+                "cpu_topology.cpp",
             ],
             publicHeadersPath: ".",
             cxxSettings: [
                 .headerSearchPath("../../Vendors/udpipe/src_lib_only"),
                 .define("UDPIPE_STATIC"),
                 .unsafeFlags(["-std=c++17"])
-            ],
+            ] + statsSettings + testingCSettings,
             linkerSettings: [
                 .linkedLibrary("c++")
             ]
@@ -136,13 +173,36 @@ let package = Package(
         .target(
             name: "UDPipe",
             dependencies: ["UDPipeCLib"],
-            path: "Sources/UDPipe"
+            path: "Sources/UDPipe",
+            swiftSettings: testingSwiftSettings
+        ),
+
+        // Benchmarks; both print JSON results. See the comment at the top of each main file.
+        .executableTarget(
+            name: "UDPipeBenchmark",
+            dependencies: ["UDPipe", "UDPipeCLib"],
+            path: "Benchmarks/UDPipeBenchmark"
+        ),
+
+        .executableTarget(
+            name: "UDPipeNativeBenchmark",
+            dependencies: ["UDPipeCLib"],
+            path: "Benchmarks/UDPipeNativeBenchmark",
+            cxxSettings: [
+                .headerSearchPath("../../Vendors/udpipe/src_lib_only"),
+                .define("UDPIPE_STATIC"),
+                .unsafeFlags(["-std=c++17"])
+            ],
+            linkerSettings: [
+                .linkedLibrary("c++")
+            ]
         ),
 
         .testTarget(
             name: "UDPipeTests",
             dependencies: ["UDPipe"],
-            path: "Tests/UDPipeTests"
+            path: "Tests/UDPipeTests",
+            swiftSettings: testingSwiftSettings + optimizedCoreSettings
         ),
     ]
 )
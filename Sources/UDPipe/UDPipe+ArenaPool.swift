@@ -0,0 +1,34 @@
+import UDPipeCLib
+
+public extension UDPipe {
+    /// Counters of the process-wide pool that result memory is allocated from.
+    struct ArenaPoolStatistics: Sendable, Equatable {
+        /// Bytes held by results that are still being converted or streamed.
+        public let bytesInUse: Int
+        /// The largest `bytesInUse` seen so far.
+        public let highWaterMark: Int
+        /// Idle bytes kept for reuse by later calls.
+        public let bytesCached: Int
+    }
+
+    /// Counters of the result memory pool.
+    ///
+    /// Native results are built in arenas whose blocks are recycled through per-thread
+    /// freelists once a call has converted them, so steady traffic doesn't go through the
+    /// system allocator.
+    static var arenaPoolStatistics: ArenaPoolStatistics {
+        var stats = udpipe_arena_pool_stats()
+        udpipe_arena_pool_get_stats(&stats)
+        return ArenaPoolStatistics(
+            bytesInUse: Int(stats.bytes_in_use),
+            highWaterMark: Int(stats.high_water),
+            bytesCached: Int(stats.bytes_cached)
+        )
+    }
+
+    /// Returns the pool's idle memory, on all threads, to the system; for example after a
+    /// burst of unusually large documents.
+    static func trimArenaPool() {
+        udpipe_arena_pool_trim()
+    }
+}
@@ -0,0 +1,251 @@
+import UDPipeCLib
+#if canImport(Darwin)
+import Darwin
+#elseif canImport(Glibc)
+import Glibc
+#endif
+
+public extension UDPipe {
+    /// Tags and optionally parses a batch of texts without blocking the calling thread.
+    ///
+    /// The batch runs on the native worker pool like `tagTokens(batch:doParse:pool:)`, and each
+    /// document is converted to Swift values on the worker that finished it. Unlike the
+    /// synchronous call, documents fail independently: a text that can't be processed yields
+    /// an empty result while the others are returned normally. (It has its own name because an
+    /// `async` overload would take over existing synchronous calls made from async code.)
+    ///
+    /// - Parameters:
+    ///   - batch: An array of strings to process.
+    ///   - doParse: If `true`, performs full dependency parsing.
+    ///   - fields: The token fields to fill in; the others are left empty and cost nothing.
+    ///   - pool: The worker pool to run on. If `nil`, a process-wide pool is used.
+    /// - Returns: One array of sentences per input string, in input order.
+    @available(macOS 10.15, iOS 13.0, tvOS 13.0, watchOS 6.0, *)
+    func tagTokensAsync(batch: [String], doParse: Bool = true, fields: Fields = .all,
+                        pool: WorkerPool? = nil) async -> [[[TaggedToken]]] {
+        guard !batch.isEmpty else { return [] }
+        return await withCheckedContinuation { continuation in
+            let results = _ResultSlots(count: batch.count)
+            let flags = Self._batchFlags(doParse, fields)
+            let started = _AsyncBatch.start(self, batch, flags: flags, pool: pool) { index, result in
+                if let all = results.store(result, at: index) {
+                    continuation.resume(returning: all)
+                }
+            }
+            if !started {
+                continuation.resume(returning: Array(repeating: [], count: batch.count))
+            }
+        }
+    }
+
+    /// Collects texts submitted one at a time into batches for the native worker pool.
+    ///
+    /// Batches amortise scheduling and tokenizer setup over many texts, but request handlers
+    /// usually have one text each. A queue groups concurrent `tag(_:)` calls: a batch is sent
+    /// as soon as `maxBatchSize` texts are waiting, or `maxDelay` seconds after the first of
+    /// them arrived. At most `maxInFlight` texts are queued or being processed at a time;
+    /// further callers are suspended until earlier ones complete, so a burst of requests
+    /// can't grow memory use without bound.
+    ///
+    /// ```swift
+    /// let queue = UDPipe.TaggingQueue(udpipe: udpipe)
+    /// let sentences = await queue.tag(requestText)
+    /// ```
+    @available(macOS 10.15, iOS 13.0, tvOS 13.0, watchOS 6.0, *)
+    actor TaggingQueue {
+        private let udpipe: UDPipe
+        private let pool: WorkerPool?
+        private let flags: UInt32
+        private let maxBatchSize: Int
+        private let maxDelayNanoseconds: UInt64
+        private let maxInFlight: Int
+
+        private var pending: [(text: String, continuation: CheckedContinuation<[[TaggedToken]], Never>)] = []
+        // Texts admitted by `tag` and not yet completed, queued or running.
+        private var inFlight = 0
+        // Callers waiting for `inFlight` to drop below `maxInFlight`.
+        private var waiting: [CheckedContinuation<Void, Never>] = []
+        // Bumped on every flush, so a timer armed for an earlier batch does nothing.
+        private var generation = 0
+
+        /// Creates a queue that tags with `udpipe`.
+        ///
+        /// - Parameters:
+        ///   - udpipe: The model to tag with.
+        ///   - doParse: If `true`, also performs dependency parsing.
+        ///   - fields: The token fields to fill in; the others are left empty and cost nothing.
+        ///   - maxBatchSize: The number of waiting texts that triggers a batch.
+        ///   - maxDelay: The longest a text waits for its batch to fill, in seconds.
+        ///   - maxInFlight: The number of texts queued or in progress above which `tag(_:)`
+        ///     suspends its caller.
+        ///   - pool: The worker pool to run on. If `nil`, a process-wide pool is used.
+        public init(udpipe: UDPipe, doParse: Bool = true, fields: Fields = .all, maxBatchSize: Int = 64,
+                    maxDelay: Double = 0.002, maxInFlight: Int = 1024, pool: WorkerPool? = nil) {
+            self.udpipe = udpipe
+            self.pool = pool
+            self.flags = UDPipe._batchFlags(doParse, fields)
+            self.maxBatchSize = max(maxBatchSize, 1)
+            self.maxDelayNanoseconds = UInt64(max(maxDelay, 0) * 1_000_000_000)
+            self.maxInFlight = max(maxInFlight, 1)
+        }
+
+        /// Tags `text` as part of the next batch.
+        ///
+        /// - Parameter text: The text to process.
+        /// - Returns: The tagged sentences of `text`, or an empty array if it couldn't be processed.
+        public func tag(_ text: String) async -> [[TaggedToken]] {
+            if inFlight < maxInFlight {
+                inFlight += 1
+            } else {
+                // `complete` hands over its slot before resuming us.
+                await withCheckedContinuation { waiting.append($0) }
+            }
+            return await withCheckedContinuation { continuation in
+                pending.append((text, continuation))
+                if pending.count >= maxBatchSize {
+                    flush()
+                } else if pending.count == 1 {
+                    armTimer()
+                }
+            }
+        }
+
+        /// Sends the texts waiting for a batch right away.
+        public func flush() {
+            guard !pending.isEmpty else { return }
+            generation += 1
+            let batch = pending
+            pending = []
+
+            let continuations = batch.map { $0.continuation }
+            let started = _AsyncBatch.start(udpipe, batch.map { $0.text }, flags: flags, pool: pool) { [self] index, result in
+                continuations[index].resume(returning: result)
+                Task { await self.complete(1) }
+            }
+            if !started {
+                for continuation in continuations {
+                    continuation.resume(returning: [])
+                }
+                complete(batch.count)
+            }
+        }
+
+        private func armTimer() {
+            let armed = generation
+            let delay = maxDelayNanoseconds
+            Task {
+                try? await Task.sleep(nanoseconds: delay)
+                await self.flush(ifGeneration: armed)
+            }
+        }
+
+        private func flush(ifGeneration armed: Int) {
+            if armed == generation { flush() }
+        }
+
+        private func complete(_ count: Int) {
+            inFlight -= count
+            while inFlight < maxInFlight, !waiting.isEmpty {
+                inFlight += 1
+                waiting.removeFirst().resume()
+            }
+        }
+    }
+}
+
+/// One batch started with `udpipe_tag_batch_async`. It keeps the input buffer, which borrowed
+/// forms point into, alive until the last document has been delivered.
+final class _AsyncBatch: @unchecked Sendable {
+    private let input: _UTF8Buffer
+    private let deliver: @Sendable (Int, [[UDPipe.TaggedToken]]) -> Void
+    private let lock = _Lock()
+    private var remaining: Int
+
+    private init(input: _UTF8Buffer, deliver: @escaping @Sendable (Int, [[UDPipe.TaggedToken]]) -> Void) {
+        self.input = input
+        self.deliver = deliver
+        self.remaining = input.count
+    }
+
+    /// Starts tagging `texts` and returns whether the batch was queued. `deliver` is then called
+    /// once per text, from native worker threads, with the text's index and its result (empty
+    /// if the document failed).
+    static func start(_ udpipe: UDPipe, _ texts: [String], flags: UInt32, pool: UDPipe.WorkerPool?,
+                      deliver: @escaping @Sendable (Int, [[UDPipe.TaggedToken]]) -> Void) -> Bool {
+        guard !texts.isEmpty else { return false }
+        let batch = _AsyncBatch(input: _UTF8Buffer(texts), deliver: deliver)
+        // Balanced by the release after the last callback.
+        let context = Unmanaged.passRetained(batch).toOpaque()
+        let ok = batch.input.withTexts { texts, lengths in
+            udpipe_tag_batch_async(udpipe.handle, pool?.handle, texts, lengths, batch.input.count, flags,
+                                   { context, index, ok, doc in
+                                       Unmanaged<_AsyncBatch>.fromOpaque(context!).takeUnretainedValue()
+                                           .complete(index, ok == 1, doc)
+                                   }, context)
+        }
+        if ok != 1 {
+            Unmanaged<_AsyncBatch>.fromOpaque(context).release()
+            return false
+        }
+        return true
+    }
+
+    fileprivate func complete(_ index: Int, _ ok: Bool, _ doc: UnsafeMutablePointer<udpipe_doc_view>?) {
+        var result: [[UDPipe.TaggedToken]] = []
+        if let doc {
+            if ok {
+                result = UDPipe._convertDocView(doc.pointee, source: UnsafeRawPointer(input.text(at: index)))
+            }
+            udpipe_doc_recycle(doc)
+        }
+        deliver(index, result)
+        let last = lock.withLock {
+            remaining -= 1
+            return remaining == 0
+        }
+        if last {
+            Unmanaged.passUnretained(self).release()
+        }
+    }
+}
+
+/// Gathers the per-document results of an asynchronous batch, which arrive in any order.
+final class _ResultSlots: @unchecked Sendable {
+    private let lock = _Lock()
+    private var results: [[[UDPipe.TaggedToken]]]
+    private var remaining: Int
+
+    init(count: Int) {
+        results = Array(repeating: [], count: count)
+        remaining = count
+    }
+
+    /// Stores one result, and returns all of them once the last one is in.
+    func store(_ result: [[UDPipe.TaggedToken]], at index: Int) -> [[[UDPipe.TaggedToken]]]? {
+        lock.withLock {
+            results[index] = result
+            remaining -= 1
+            return remaining == 0 ? results : nil
+        }
+    }
+}
+
+/// A mutex for state touched from native worker threads.
+final class _Lock: @unchecked Sendable {
+    private let mutex: UnsafeMutablePointer<pthread_mutex_t> = .allocate(capacity: 1)
+
+    init() {
+        pthread_mutex_init(mutex, nil)
+    }
+
+    deinit {
+        pthread_mutex_destroy(mutex)
+        mutex.deallocate()
+    }
+
+    func withLock<R>(_ body: () throws -> R) rethrows -> R {
+        pthread_mutex_lock(mutex)
+        defer { pthread_mutex_unlock(mutex) }
+        return try body()
+    }
+}
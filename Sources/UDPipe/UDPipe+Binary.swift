@@ -0,0 +1,40 @@
+import UDPipeCLib
+
+public extension UDPipe {
+    /// Processes the input text and serialises the result in UDPipe's compact binary document
+    /// format, for handing results to another process without formatting and re-parsing
+    /// CoNLL-U.
+    ///
+    /// - Parameters:
+    ///   - text: The text to process.
+    ///   - doParse: If `true`, performs dependency parsing as well as tagging.
+    /// - Returns: The encoded document, or `nil` on failure.
+    func tagBinary(_ text: String, doParse: Bool = true) -> [UInt8]? {
+        let flags = UInt32(UDPIPE_STAGE_TAG) | (doParse ? UInt32(UDPIPE_STAGE_PARSE) : 0)
+        var text = text
+        return text.withUTF8 { buf -> [UInt8]? in
+            var out: UnsafeMutablePointer<CChar>? = nil
+            var length = 0
+            let source = UnsafeRawPointer(buf.baseAddress)?.assumingMemoryBound(to: CChar.self)
+            guard udpipe_tag_binary(handle, source, buf.count, flags, &out, &length) == 1, let out else { return nil }
+            defer { udpipe_binary_free(out) }
+            return Array(UnsafeRawBufferPointer(start: out, count: length))
+        }
+    }
+
+    /// Decodes a document produced by `tagBinary(_:doParse:)`, in this process or another one.
+    /// No model is needed.
+    ///
+    /// - Parameter bytes: The encoded document.
+    /// - Returns: The document's sentences, or `nil` if `bytes` is not a valid document of a
+    ///   supported format version.
+    static func decodeBinary(_ bytes: [UInt8]) -> [[TaggedToken]]? {
+        bytes.withUnsafeBufferPointer { buf -> [[TaggedToken]]? in
+            var doc = udpipe_doc_view()
+            let base = UnsafeRawPointer(buf.baseAddress)?.assumingMemoryBound(to: CChar.self)
+            guard udpipe_binary_open(base, buf.count, &doc) == 1 else { return nil }
+            defer { udpipe_doc_recycle(&doc) }
+            return _convertDocView(doc)
+        }
+    }
+}
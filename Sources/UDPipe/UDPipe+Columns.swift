@@ -0,0 +1,130 @@
+import UDPipeCLib
+
+public extension UDPipe {
+    /// A tagged document stored column by column, for code that scans one or two fields over
+    /// many tokens.
+    ///
+    /// Token `i` of the document is entry `i` of every per-token array. Forms and lemmas are
+    /// packed UTF-8 buffers with `count + 1` offsets, and tag fields are vocabulary ids that
+    /// `UDPipe.vocabulary(for:)` resolves. The layout maps directly onto Arrow arrays.
+    struct TokenColumns: Sendable, Equatable {
+        /// 1-based word ids within their sentence.
+        public var ids: [Int32] = []
+        /// Head word ids (`0` for the root), or `-1` without parsing.
+        public var heads: [Int32] = []
+        /// Vocabulary ids of the UPOS, XPOS, FEATS and DEPREL values.
+        public var uposIds: [UInt16] = []
+        public var xposIds: [UInt16] = []
+        public var featsIds: [UInt16] = []
+        public var deprelIds: [UInt16] = []
+        /// UTF-8 byte offsets of each token in the input.
+        public var starts: [UInt32] = []
+        public var ends: [UInt32] = []
+        /// `UDPIPE_TOKEN_*` bits of each token.
+        public var flags: [UInt16] = []
+        /// Packed forms; token `i`'s form is `forms[formOffsets[i]..<formOffsets[i + 1]]`.
+        public var forms: [UInt8] = []
+        public var formOffsets: [UInt32] = [0]
+        /// Packed lemmas, indexed like `forms`.
+        public var lemmas: [UInt8] = []
+        public var lemmaOffsets: [UInt32] = [0]
+        /// Sentence `j` holds tokens `sentenceOffsets[j]..<sentenceOffsets[j + 1]`.
+        public var sentenceOffsets: [UInt32] = [0]
+
+        /// The number of tokens.
+        public var count: Int { ids.count }
+
+        /// The number of sentences.
+        public var sentenceCount: Int { sentenceOffsets.count - 1 }
+
+        /// The form of token `i`.
+        public func form(at i: Int) -> String {
+            String(decoding: forms[Int(formOffsets[i])..<Int(formOffsets[i + 1])], as: UTF8.self)
+        }
+
+        /// The lemma of token `i`.
+        public func lemma(at i: Int) -> String {
+            String(decoding: lemmas[Int(lemmaOffsets[i])..<Int(lemmaOffsets[i + 1])], as: UTF8.self)
+        }
+    }
+
+    /// Processes the input text and returns its tokens as columns.
+    ///
+    /// - Parameters:
+    ///   - text: The text to process.
+    ///   - doParse: If `true`, also fills `heads` and `deprelIds`.
+    ///   - fields: The token fields to fill in; the columns of the others are empty strings
+    ///     and id 0.
+    /// - Returns: The document's columns, empty on failure.
+    func tagColumns(_ text: String, doParse: Bool = true, fields: Fields = .all) -> TokenColumns {
+        let flags = UInt32(UDPIPE_OUTPUT_COLUMNS) | Self._stageFlags(doParse, fields)
+        var text = text
+        return text.withUTF8 { buf in
+            var doc = udpipe_doc_view()
+            let source = UnsafeRawPointer(buf.baseAddress)?.assumingMemoryBound(to: CChar.self)
+            guard udpipe_tag_structured_ex(handle, source, buf.count, flags, &doc) == 1 else { return TokenColumns() }
+            defer { udpipe_doc_recycle(&doc) }
+            return _convertColumns(doc)
+        }
+    }
+
+    /// Processes a batch of input texts in parallel and returns each one's tokens as columns.
+    ///
+    /// - Parameters:
+    ///   - batch: An array of strings to process.
+    ///   - doParse: If `true`, also fills `heads` and `deprelIds`.
+    ///   - fields: The token fields to fill in; the columns of the others are empty strings
+    ///     and id 0.
+    ///   - pool: The worker pool to run on. If `nil`, a process-wide pool is used.
+    /// - Returns: One entry per input string; entries for texts that fail are empty.
+    func tagColumns(batch: [String], doParse: Bool = true, fields: Fields = .all,
+                    pool: WorkerPool? = nil) -> [TokenColumns] {
+        let input = _UTF8Buffer(batch)
+        var outDocs: UnsafeMutablePointer<udpipe_doc_view>? = nil
+        var outSize: Int = 0
+        let flags = UInt32(UDPIPE_OUTPUT_COLUMNS | UDPIPE_PARTIAL_BATCH) | Self._stageFlags(doParse, fields)
+        let ok = input.withTexts { texts, lengths in
+            udpipe_tag_batch_ex(handle, pool?.handle, texts, lengths, batch.count, flags, &outDocs, &outSize)
+        }
+        guard ok == 1, let docs = outDocs, outSize == batch.count else {
+            if let docs = outDocs { udpipe_batch_recycle(docs, outSize) }
+            return Array(repeating: TokenColumns(), count: batch.count)
+        }
+        defer { udpipe_batch_recycle(docs, outSize) }
+        return (0..<outSize).map { _convertColumns(docs[$0]) }
+    }
+
+    /// Copies the columns of a document built with `UDPIPE_OUTPUT_COLUMNS`.
+    internal func _convertColumns(_ doc: udpipe_doc_view) -> TokenColumns {
+        guard let c = doc.columns?.pointee else { return TokenColumns() }
+        return _timedConversion {
+            let n = Int(doc.token_count)
+            func column<T>(_ p: UnsafePointer<T>?, _ count: Int) -> [T] {
+                guard let p, count > 0 else { return [] }
+                return Array(UnsafeBufferPointer(start: p, count: count))
+            }
+            func bytes(_ p: UnsafePointer<CChar>?, _ count: UInt32) -> [UInt8] {
+                guard let p, count > 0 else { return [] }
+                return p.withMemoryRebound(to: UInt8.self, capacity: Int(count)) {
+                    Array(UnsafeBufferPointer(start: $0, count: Int(count)))
+                }
+            }
+            var out = TokenColumns()
+            out.ids = column(c.ids, n)
+            out.heads = column(c.heads, n)
+            out.uposIds = column(c.upos_ids, n)
+            out.xposIds = column(c.xpostag_ids, n)
+            out.featsIds = column(c.feats_ids, n)
+            out.deprelIds = column(c.deprel_ids, n)
+            out.starts = column(c.starts, n)
+            out.ends = column(c.ends, n)
+            out.flags = column(c.flags, n)
+            out.formOffsets = column(c.form_offsets, n + 1)
+            out.forms = bytes(c.forms, out.formOffsets[n])
+            out.lemmaOffsets = column(c.lemma_offsets, n + 1)
+            out.lemmas = bytes(c.lemmas, out.lemmaOffsets[n])
+            out.sentenceOffsets = column(c.sentence_offsets, Int(doc.count) + 1)
+            return out
+        }
+    }
+}
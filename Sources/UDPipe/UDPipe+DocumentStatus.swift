@@ -0,0 +1,82 @@
+import UDPipeCLib
+
+public extension UDPipe {
+    /// How processing one document of a batch went.
+    enum DocumentStatus: Sendable, Equatable {
+        /// Every sentence was processed.
+        case ok
+        /// The document was processed, but `skippedSentences` sentences were left out because
+        /// the tagger or parser failed on them, or the tokenizer stopped early. `error` is the
+        /// first failure.
+        case partial(skippedSentences: Int, error: String)
+        /// Nothing could be produced for the document.
+        case failed(error: String)
+
+        init(_ doc: udpipe_doc_view) {
+            let error = doc.error.map { String(cString: $0) }
+            switch Int(doc.status) {
+            case UDPIPE_DOC_OK:
+                self = .ok
+            case UDPIPE_DOC_PARTIAL:
+                self = .partial(skippedSentences: Int(doc.skipped_sentences), error: error ?? "")
+            default:
+                self = .failed(error: error ?? "processing failed")
+            }
+        }
+    }
+
+    /// The result of one document of `tagTokensWithStatus(batch:doParse:fields:skipBadSentences:pool:)`.
+    struct DocumentResult: Sendable {
+        /// The tagged sentences; empty if the document failed.
+        public let sentences: [[TaggedToken]]
+        /// Whether the document was processed completely.
+        public let status: DocumentStatus
+    }
+
+    /// Processes a batch like `tagTokens(batch:doParse:pool:)` and reports, for every text,
+    /// whether it was processed completely and why not.
+    ///
+    /// Texts fail independently: a text the engine can't process doesn't discard the rest of
+    /// the batch. With `skipBadSentences`, a sentence the tagger or parser fails on is left out
+    /// instead of failing its whole text, and a tokenizer error keeps the sentences read before it.
+    ///
+    /// - Parameters:
+    ///   - batch: An array of strings to process.
+    ///   - doParse: If `true`, performs full dependency parsing.
+    ///   - fields: The token fields to fill in; the others are left empty and cost nothing.
+    ///   - skipBadSentences: If `true`, drops failing sentences rather than failing the text.
+    ///   - pool: The worker pool to run on. If `nil`, a process-wide pool is used.
+    /// - Returns: One result per input string, in input order.
+    func tagTokensWithStatus(batch: [String], doParse: Bool = true, fields: Fields = .all,
+                             skipBadSentences: Bool = false, pool: WorkerPool? = nil) -> [DocumentResult] {
+        let input = _UTF8Buffer(batch)
+        var outDocs: UnsafeMutablePointer<udpipe_doc_view>? = nil
+        var outSize = 0
+        let flags = Self._batchFlags(doParse, fields) | UInt32(UDPIPE_PARTIAL_BATCH)
+            | (skipBadSentences ? UInt32(UDPIPE_SKIP_BAD_SENTENCES) : 0)
+        let ok = input.withTexts { texts, lengths in
+            udpipe_tag_batch_ex(handle, pool?.handle, texts, lengths, batch.count, flags, &outDocs, &outSize)
+        }
+        guard ok == 1, let docs = outDocs, outSize == batch.count else {
+            if let docs = outDocs { udpipe_batch_recycle(docs, outSize) }
+            let status = DocumentStatus.failed(error: "the batch could not be processed")
+            return batch.map { _ in DocumentResult(sentences: [], status: status) }
+        }
+        defer { udpipe_batch_recycle(docs, outSize) }
+        return (0..<outSize).map { i in
+            DocumentResult(
+                sentences: Self._convertDocView(docs[i], source: UnsafeRawPointer(input.text(at: i))),
+                status: DocumentStatus(docs[i])
+            )
+        }
+    }
+}
+
+extension udpipe_doc_view {
+    /// An empty document marked `UDPIPE_DOC_FAILED`, for calls that produced nothing.
+    static var _failed: udpipe_doc_view {
+        var doc = udpipe_doc_view()
+        doc.status = Int32(UDPIPE_DOC_FAILED)
+        return doc
+    }
+}
@@ -0,0 +1,40 @@
+import UDPipeCLib
+
+public extension UDPipe {
+    /// The token fields a tagging call fills in.
+    ///
+    /// Fields left out come back empty (an empty lemma, `.other` POS, no XPOS, features,
+    /// head or relation) and are neither copied out of the engine nor converted. Stages
+    /// only those fields need are skipped: without `.dependencies` the parser doesn't run
+    /// even if `doParse` is `true`, and an empty set only tokenizes.
+    struct Fields: OptionSet, Sendable {
+        public let rawValue: UInt32
+
+        public init(rawValue: UInt32) {
+            self.rawValue = rawValue
+        }
+
+        public static let lemma = Fields(rawValue: UInt32(UDPIPE_WANT_LEMMA))
+        public static let upos = Fields(rawValue: UInt32(UDPIPE_WANT_UPOS))
+        public static let xpos = Fields(rawValue: UInt32(UDPIPE_WANT_XPOS))
+        public static let features = Fields(rawValue: UInt32(UDPIPE_WANT_FEATS))
+        /// Heads and dependency relations.
+        public static let dependencies = Fields(rawValue: UInt32(UDPIPE_WANT_DEPS))
+        public static let all: Fields = [.lemma, .upos, .xpos, .features, .dependencies]
+    }
+}
+
+extension UDPipe {
+    /// The stage and field bits of `flags` for a call that tags, optionally parses, and fills
+    /// in `fields`. Selecting no fields leaves only tokenization.
+    static func _stageFlags(_ doParse: Bool, _ fields: Fields) -> UInt32 {
+        guard !fields.isEmpty else { return 0 }
+        return UInt32(UDPIPE_STAGE_TAG) | (doParse ? UInt32(UDPIPE_STAGE_PARSE) : 0) | fields.rawValue
+    }
+
+    /// `_stageFlags` plus `UDPIPE_BORROW_FORMS`, for the batch and borrowed-form calls. These
+    /// keep their input alive while converting the results, and read verbatim forms from it.
+    static func _batchFlags(_ doParse: Bool, _ fields: Fields = .all) -> UInt32 {
+        UInt32(UDPIPE_BORROW_FORMS) | _stageFlags(doParse, fields)
+    }
+}
@@ -11,6 +11,14 @@ public extension UDPipe {
     enum UDPipeError: Error, Sendable {
         /// Thrown when loading a model from a file path fails.
         case modelLoadFailed(path: String)
+        /// Thrown when the native worker threads of a `WorkerPool` cannot be started.
+        case poolCreationFailed
+        /// Thrown when a `Session` cannot be created for a model.
+        case sessionCreationFailed
+        /// Thrown when a sentence stream cannot be opened or a sentence fails to process.
+        case streamFailed
+        /// Thrown when a `ModelRegistry` cannot start its background loader.
+        case registryCreationFailed
     }
 
     /// Parses a string in CoNLL-U format into tagged tokens, grouped by sentence.
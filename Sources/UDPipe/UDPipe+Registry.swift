@@ -0,0 +1,66 @@
+import UDPipeCLib
+
+public extension UDPipe {
+    /// Shares loaded models between the parts of a process that use them.
+    ///
+    /// Each model file is loaded once, however many callers ask for it at the same time. When
+    /// a file changes on disk, the registry keeps returning the loaded model while it reloads
+    /// the file in the background, then swaps the new model in. `UDPipe` instances obtained
+    /// earlier keep working on the old model until they are released, so in-flight requests
+    /// are never disturbed by a reload.
+    ///
+    /// ```swift
+    /// let registry = try UDPipe.ModelRegistry(memoryBudget: 4 << 30)
+    /// let english = try registry.model(at: "/models/english.udpipe")
+    /// ```
+    final class ModelRegistry: @unchecked Sendable {
+        let handle: udpipe_registry_t
+
+        /// Creates an empty registry.
+        ///
+        /// - Parameter memoryBudget: The most bytes of models (counted by file size) to keep
+        ///   loaded. Least recently requested models are dropped beyond it. Pass `0` for no limit.
+        /// - Throws: `UDPipeError.registryCreationFailed` if the background loader cannot be started.
+        public init(memoryBudget: Int = 0) throws {
+            guard let h = udpipe_registry_create(max(memoryBudget, 0)) else {
+                throw UDPipeError.registryCreationFailed
+            }
+            self.handle = h
+        }
+
+        deinit {
+            udpipe_registry_free(handle)
+        }
+
+        /// Returns the model at `path`, loading it first if the registry doesn't hold it yet.
+        ///
+        /// - Parameter path: Path to the `.udpipe` model file.
+        /// - Throws: `UDPipeError.modelLoadFailed` if the model cannot be loaded.
+        public func model(at path: String) throws -> UDPipe {
+            guard let h = udpipe_registry_acquire(handle, path) else {
+                throw UDPipeError.modelLoadFailed(path: path)
+            }
+            return UDPipe(retainedHandle: h)
+        }
+
+        /// Starts loading the model at `path` in the background, so that a later call to
+        /// `model(at:)` doesn't wait for it.
+        ///
+        /// - Parameter path: Path to the `.udpipe` model file.
+        /// - Returns: `false` if the file doesn't exist.
+        @discardableResult
+        public func preload(_ path: String) -> Bool {
+            udpipe_registry_preload(handle, path) == 1
+        }
+
+        /// The number of models currently held.
+        public var count: Int {
+            udpipe_registry_size(handle)
+        }
+
+        /// The size in bytes of the model files currently held.
+        public var memoryUsage: Int {
+            udpipe_registry_memory_usage(handle)
+        }
+    }
+}
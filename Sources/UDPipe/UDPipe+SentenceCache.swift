@@ -0,0 +1,33 @@
+import UDPipeCLib
+
+public extension UDPipe {
+    /// Counters of a model's sentence cache.
+    struct SentenceCacheStatistics: Sendable, Equatable {
+        /// Sentences annotated from the cache.
+        public let hits: Int
+        /// Sentences that were tagged (and parsed) and then cached.
+        public let misses: Int
+        /// Sentences currently cached.
+        public let entries: Int
+    }
+
+    /// Enables a cache of tagging and parsing results for repeated sentences.
+    ///
+    /// With a cache, every tokenized sentence whose words and requested stages were seen
+    /// before is annotated from the cache instead of running the tagger and parser again.
+    /// This makes repetitive traffic (boilerplate, headlines, templated messages) much cheaper.
+    /// Results are identical to uncached processing; offsets always come from the new text.
+    ///
+    /// - Parameter capacity: The number of sentences to keep, least recently used ones being
+    ///   dropped first. Pass `0` to disable caching. Any previous cache is discarded.
+    func setSentenceCache(capacity: Int) {
+        _ = udpipe_model_set_sentence_cache(handle, max(capacity, 0))
+    }
+
+    /// Hit and miss counters of the current sentence cache, all zero if none is enabled.
+    var sentenceCacheStatistics: SentenceCacheStatistics {
+        var stats = udpipe_cache_stats()
+        udpipe_model_sentence_cache_stats(handle, &stats)
+        return SentenceCacheStatistics(hits: Int(stats.hits), misses: Int(stats.misses), entries: Int(stats.entries))
+    }
+}
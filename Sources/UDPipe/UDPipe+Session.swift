@@ -0,0 +1,77 @@
+import UDPipeCLib
+
+public extension UDPipe {
+    /// A reusable processing context bound to one model.
+    ///
+    /// A session keeps the native tokenizer and its working buffers alive between calls, so
+    /// repeated short requests skip the per-call setup that `UDPipe.tagTokens(_:doParse:)` and
+    /// `UDPipe.tokenize(_:options:)` pay. A session is not thread-safe: create one per thread
+    /// (or per task) and don't share it.
+    final class Session {
+        private let udpipe: UDPipe
+        private let handle: udpipe_session_t
+
+        /// Creates a session for the given model.
+        ///
+        /// - Parameters:
+        ///   - udpipe: The model to process text with. The session keeps it alive.
+        ///   - tokenizerOptions: Optional tokenizer options for the underlying UDPipe engine.
+        /// - Throws: `UDPipeError.sessionCreationFailed` if the model has no usable tokenizer.
+        public init(udpipe: UDPipe, tokenizerOptions: String? = nil) throws {
+            let h: udpipe_session_t?
+            if let opt = tokenizerOptions {
+                h = opt.withCString { o in udpipe_session_create(udpipe.handle, o) }
+            } else {
+                h = udpipe_session_create(udpipe.handle, nil)
+            }
+            guard let h else { throw UDPipeError.sessionCreationFailed }
+            self.udpipe = udpipe
+            self.handle = h
+        }
+
+        deinit {
+            udpipe_session_free(handle)
+        }
+
+        /// Processes the input text and returns rich tagged information for each token,
+        /// grouped by sentence.
+        ///
+        /// - Parameters:
+        ///   - text: The text to process.
+        ///   - doParse: If `true`, also performs dependency parsing.
+        ///   - fields: The token fields to fill in; the others are left empty and cost nothing.
+        /// - Returns: An array of sentences, where each sentence is an array of `TaggedToken`s.
+        public func tagTokens(_ text: String, doParse: Bool = true, fields: Fields = .all) -> [[TaggedToken]] {
+            let flags = UDPipe._batchFlags(doParse, fields)
+            return process(text, flags: flags) { doc, source in UDPipe._convertDocView(doc, source: source) } ?? []
+        }
+
+        /// Tokenizes the input text into sentences using the session's tokenizer options.
+        ///
+        /// - Parameter text: The text to tokenize.
+        /// - Returns: An array of `Sentence` objects.
+        public func tokenize(_ text: String) -> [Sentence] {
+            let flags = UInt32(UDPIPE_BORROW_FORMS)
+            return process(text, flags: flags) { doc, source in UDPipe._convertTokenizedDoc(doc, source: source) } ?? []
+        }
+
+        /// Runs the session over the UTF-8 bytes of `text` and converts the result while the
+        /// input buffer (which borrowed forms point into) is still alive.
+        private func process<R>(
+            _ text: String,
+            flags: UInt32,
+            _ convert: (udpipe_doc_view, UnsafeRawPointer?) -> R
+        ) -> R? {
+            var text = text
+            return text.withUTF8 { buf in
+                var doc = udpipe_doc_view()
+                let source = UnsafeRawPointer(buf.baseAddress)
+                guard udpipe_session_process(handle, source?.assumingMemoryBound(to: CChar.self), buf.count, flags, &doc) == 1
+                else { return nil }
+                defer { udpipe_doc_recycle(&doc) }
+
+                return convert(doc, source)
+            }
+        }
+    }
+}
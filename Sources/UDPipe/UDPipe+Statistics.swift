@@ -0,0 +1,102 @@
+import UDPipeCLib
+#if canImport(Darwin)
+import Darwin
+#elseif canImport(Glibc)
+import Glibc
+#endif
+
+public extension UDPipe {
+    /// Timings of one processing stage.
+    struct StageStatistics: Sendable, Equatable {
+        /// Number of timed calls.
+        public let count: Int
+        /// Summed duration of those calls, in nanoseconds.
+        public let totalNanoseconds: UInt64
+        /// Call counts by duration: entry `i` counts calls that took `2^i` to `2^(i+1)`
+        /// nanoseconds (the first entry also holds shorter ones, the last one longer ones).
+        public let histogram: [UInt64]
+
+        /// An upper bound on the given quantile (between 0 and 1) of the call durations, in
+        /// nanoseconds, read from the histogram; `0` if nothing was timed, and `UInt64.max` if
+        /// the quantile falls in the open-ended last bucket.
+        public func percentile(_ quantile: Double) -> UInt64 {
+            guard count > 0 else { return 0 }
+            let target = UInt64((min(max(quantile, 0), 1) * Double(count)).rounded(.up))
+            var seen: UInt64 = 0
+            for (bucket, n) in histogram.enumerated() {
+                seen += n
+                if seen >= max(target, 1) { return bucket + 1 < histogram.count ? UInt64(1) << UInt64(bucket + 1) : .max }
+            }
+            return .max
+        }
+    }
+
+    /// Process-wide processing statistics summed over all threads.
+    struct Statistics: Sendable, Equatable {
+        /// Splitting text into sentences and tokens.
+        public let tokenize: StageStatistics
+        /// Tagging, per sentence.
+        public let tag: StageStatistics
+        /// Parsing, per sentence.
+        public let parse: StageStatistics
+        /// Copying native sentences into the C result structures.
+        public let marshal: StageStatistics
+        /// Converting C results into Swift values.
+        public let convert: StageStatistics
+        /// Sentences returned in results.
+        public let sentences: Int
+        /// Tokens returned in results.
+        public let tokens: Int
+        /// Bytes of result memory allocated.
+        public let arenaBytes: Int
+    }
+
+    /// Statistics counted since start-up or the last `resetStatistics()`, or `nil` if the
+    /// package was built without instrumentation (build with `UDPIPE_STATS=1` to enable it).
+    static var statistics: Statistics? {
+        var stats = udpipe_stats()
+        guard udpipe_stats_snapshot(&stats) == 1 else { return nil }
+        let stages = withUnsafeBytes(of: stats.stages) { raw in
+            raw.bindMemory(to: udpipe_stage_stats.self).map { stage in
+                StageStatistics(
+                    count: Int(stage.count),
+                    totalNanoseconds: stage.total_ns,
+                    histogram: withUnsafeBytes(of: stage.histogram) { Array($0.bindMemory(to: UInt64.self)) }
+                )
+            }
+        }
+        return Statistics(
+            tokenize: stages[Int(UDPIPE_STAT_TOKENIZE)],
+            tag: stages[Int(UDPIPE_STAT_TAG)],
+            parse: stages[Int(UDPIPE_STAT_PARSE)],
+            marshal: stages[Int(UDPIPE_STAT_MARSHAL)],
+            convert: stages[Int(UDPIPE_STAT_CONVERT)],
+            sentences: Int(stats.sentences),
+            tokens: Int(stats.tokens),
+            arenaBytes: Int(stats.arena_bytes)
+        )
+    }
+
+    /// Restarts all statistics from zero.
+    static func resetStatistics() {
+        udpipe_stats_reset()
+    }
+}
+
+/// Whether the native library was built with instrumentation; checked once.
+let _statsEnabled = udpipe_stats_enabled() == 1
+
+/// Runs `body`, recording its duration as the conversion stage when instrumentation is
+/// compiled in.
+@inline(__always)
+func _timedConversion<T>(_ body: () -> T) -> T {
+    guard _statsEnabled else { return body() }
+    var start = timespec()
+    clock_gettime(CLOCK_MONOTONIC, &start)
+    let result = body()
+    var end = timespec()
+    clock_gettime(CLOCK_MONOTONIC, &end)
+    let ns = (Int64(end.tv_sec) - Int64(start.tv_sec)) * 1_000_000_000 + (Int64(end.tv_nsec) - Int64(start.tv_nsec))
+    udpipe_stats_record(Int32(UDPIPE_STAT_CONVERT), UInt64(max(ns, 0)))
+    return result
+}
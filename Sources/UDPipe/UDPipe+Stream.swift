@@ -0,0 +1,217 @@
+import Dispatch
+import UDPipeCLib
+#if canImport(Darwin)
+import Darwin
+#elseif canImport(Glibc)
+import Glibc
+#endif
+
+public extension UDPipe {
+    /// Returns the tagged sentences of `text` as an asynchronous sequence.
+    ///
+    /// Sentences are tagged one at a time, as the sequence is iterated, so the first result
+    /// is available right away and memory use stays bounded by the longest sentence instead
+    /// of growing with the length of the text.
+    ///
+    /// ```swift
+    /// for try await sentence in udpipe.sentences(longText) {
+    ///     print(sentence.map(\.form))
+    /// }
+    /// ```
+    ///
+    /// - Parameters:
+    ///   - text: The text to process.
+    ///   - doParse: If `true`, also performs dependency parsing.
+    ///   - tokenizerOptions: Optional tokenizer options for the underlying UDPipe engine.
+    /// - Returns: A sequence yielding one array of `TaggedToken`s per sentence.
+    @available(macOS 10.15, iOS 13.0, tvOS 13.0, watchOS 6.0, *)
+    func sentences(_ text: String, doParse: Bool = true, tokenizerOptions: String? = nil) -> SentenceStream {
+        let flags = UInt32(UDPIPE_STAGE_TAG | UDPIPE_BORROW_FORMS) | (doParse ? UInt32(UDPIPE_STAGE_PARSE) : 0)
+        return SentenceStream(udpipe: self, input: .text(text), flags: flags, tokenizerOptions: tokenizerOptions)
+    }
+
+    /// Returns the tagged sentences of the file at `path` as an asynchronous sequence.
+    ///
+    /// The file is read in chunks as the sequence is iterated, so it doesn't need to fit in
+    /// memory. Reads happen on a dispatch queue, so a slow file system doesn't hold up a
+    /// thread of the concurrency pool. Token offsets are UTF-8 byte offsets from the start of
+    /// the file. Each iteration opens the file anew; iteration throws
+    /// `UDPipeError.streamFailed` if it can't be opened or read.
+    ///
+    /// - Parameters:
+    ///   - path: Path of a UTF-8 text file.
+    ///   - doParse: If `true`, also performs dependency parsing.
+    ///   - tokenizerOptions: Optional tokenizer options for the underlying UDPipe engine.
+    /// - Returns: A sequence yielding one array of `TaggedToken`s per sentence.
+    @available(macOS 10.15, iOS 13.0, tvOS 13.0, watchOS 6.0, *)
+    func sentences(contentsOfFile path: String, doParse: Bool = true, tokenizerOptions: String? = nil) -> SentenceStream {
+        let flags = UInt32(UDPIPE_STAGE_TAG) | (doParse ? UInt32(UDPIPE_STAGE_PARSE) : 0)
+        return SentenceStream(udpipe: self, input: .path(path), flags: flags, tokenizerOptions: tokenizerOptions)
+    }
+
+    /// Returns the tagged sentences read from an open file descriptor (for example
+    /// `STDIN_FILENO`) as an asynchronous sequence.
+    ///
+    /// The descriptor is read until end of file as the sequence is iterated, and is not
+    /// closed. Reads happen on a dispatch queue, so waiting for input (say, on a pipe or
+    /// a terminal) suspends the iterating task rather than blocking a thread of the
+    /// concurrency pool. Iterate the sequence only once.
+    ///
+    /// - Parameters:
+    ///   - fileDescriptor: A descriptor open for reading UTF-8 text.
+    ///   - doParse: If `true`, also performs dependency parsing.
+    ///   - tokenizerOptions: Optional tokenizer options for the underlying UDPipe engine.
+    /// - Returns: A sequence yielding one array of `TaggedToken`s per sentence.
+    @available(macOS 10.15, iOS 13.0, tvOS 13.0, watchOS 6.0, *)
+    func sentences(fileDescriptor: Int32, doParse: Bool = true, tokenizerOptions: String? = nil) -> SentenceStream {
+        let flags = UInt32(UDPIPE_STAGE_TAG) | (doParse ? UInt32(UDPIPE_STAGE_PARSE) : 0)
+        return SentenceStream(
+            udpipe: self,
+            input: .fileDescriptor(fileDescriptor),
+            flags: flags,
+            tokenizerOptions: tokenizerOptions
+        )
+    }
+
+    /// An asynchronous sequence of tagged sentences. See `UDPipe.sentences(_:doParse:tokenizerOptions:)`
+    /// and its file-reading counterparts.
+    ///
+    /// Iteration throws `UDPipeError.streamFailed` if the model has no tokenizer or a sentence
+    /// fails to process.
+    @available(macOS 10.15, iOS 13.0, tvOS 13.0, watchOS 6.0, *)
+    struct SentenceStream: AsyncSequence {
+        public typealias Element = [TaggedToken]
+
+        enum Input {
+            case text(String)
+            case path(String)
+            case fileDescriptor(Int32)
+        }
+
+        let udpipe: UDPipe
+        let input: Input
+        let flags: UInt32
+        let tokenizerOptions: String?
+
+        public func makeAsyncIterator() -> AsyncIterator {
+            AsyncIterator(cursor: _StreamCursor(udpipe: udpipe, input: input, flags: flags, tokenizerOptions: tokenizerOptions))
+        }
+
+        public struct AsyncIterator: AsyncIteratorProtocol {
+            let cursor: _StreamCursor?
+
+            public mutating func next() async throws -> [TaggedToken]? {
+                guard let cursor else { throw UDPipeError.streamFailed }
+                return try await cursor.next()
+            }
+        }
+    }
+}
+
+/// Owns a native stream together with what it reads from: the UTF-8 copy of the text
+/// (which borrowed forms point into) or the file it opened. Both are released when the
+/// iterator goes away. File input is read here, off the concurrency pool, and fed to a
+/// chunked stream whenever it asks for more.
+final class _StreamCursor {
+    private static let readSize = 1 << 16
+
+    private let udpipe: UDPipe
+    private let handle: udpipe_stream_t
+    private let buffer: UnsafeMutableBufferPointer<UInt8>?
+    private let inputFD: Int32?
+    private let ownedFD: Int32?
+    private let readQueue = DispatchQueue(label: "UDPipe.SentenceStream.read")
+    private var tags = _TagDecodeCache()
+
+    @available(macOS 10.15, iOS 13.0, tvOS 13.0, watchOS 6.0, *)
+    init?(udpipe: UDPipe, input: UDPipe.SentenceStream.Input, flags: UInt32, tokenizerOptions: String?) {
+        var buffer: UnsafeMutableBufferPointer<UInt8>? = nil
+        var inputFD: Int32? = nil
+        var ownedFD: Int32? = nil
+
+        let makeStream: (UnsafePointer<CChar>?) -> udpipe_stream_t? = { options in
+            switch input {
+            case .text(let text):
+                let utf8 = text.utf8
+                let copy = UnsafeMutableBufferPointer<UInt8>.allocate(capacity: max(utf8.count, 1))
+                _ = copy.initialize(from: utf8)
+                buffer = copy
+                let base = UnsafeRawPointer(copy.baseAddress!).assumingMemoryBound(to: CChar.self)
+                return udpipe_stream_open(udpipe.handle, base, utf8.count, options, flags)
+            case .path(let path):
+                let fd = open(path, O_RDONLY)
+                guard fd >= 0 else { return nil }
+                ownedFD = fd
+                inputFD = fd
+                return udpipe_stream_create(udpipe.handle, options, flags)
+            case .fileDescriptor(let fd):
+                inputFD = fd
+                return udpipe_stream_create(udpipe.handle, options, flags)
+            }
+        }
+
+        let h: udpipe_stream_t?
+        if let opt = tokenizerOptions {
+            h = opt.withCString { o in makeStream(o) }
+        } else {
+            h = makeStream(nil)
+        }
+        guard let h else {
+            buffer?.deallocate()
+            if let fd = ownedFD { close(fd) }
+            return nil
+        }
+        self.udpipe = udpipe
+        self.handle = h
+        self.buffer = buffer
+        self.inputFD = inputFD
+        self.ownedFD = ownedFD
+    }
+
+    deinit {
+        udpipe_stream_close(handle)
+        buffer?.deallocate()
+        if let fd = ownedFD { close(fd) }
+    }
+
+    func next() async throws -> [TaggedToken]? {
+        var sv = udpipe_sentence_view()
+        while true {
+            switch Int(udpipe_stream_next(handle, &sv)) {
+            case UDPIPE_STREAM_SENTENCE:
+                return _timedConversion {
+                    UDPipe._convertSentence(sv, source: buffer.flatMap { UnsafeRawPointer($0.baseAddress) }, tags: &tags)
+                }
+            case UDPIPE_STREAM_END:
+                return nil
+            case UDPIPE_STREAM_NEED_INPUT:
+                guard let fd = inputFD, let chunk = await readChunk(fd) else { throw UDPipe.UDPipeError.streamFailed }
+                let fed = chunk.isEmpty
+                    ? udpipe_stream_finish(handle)
+                    : chunk.withUnsafeBufferPointer { udpipe_stream_feed(handle, $0.baseAddress, $0.count) }
+                if fed == 0 { throw UDPipe.UDPipeError.streamFailed }
+            default:
+                throw UDPipe.UDPipeError.streamFailed
+            }
+        }
+    }
+
+    /// Reads the next chunk of `fd` on `readQueue`: empty at end of file, `nil` on error.
+    private func readChunk(_ fd: Int32) async -> [CChar]? {
+        await withCheckedContinuation { continuation in
+            readQueue.async {
+                var chunk = [CChar](repeating: 0, count: _StreamCursor.readSize)
+                var n: Int
+                repeat {
+                    n = chunk.withUnsafeMutableBytes { read(fd, $0.baseAddress, $0.count) }
+                } while n < 0 && errno == EINTR
+                if n < 0 {
+                    continuation.resume(returning: nil)
+                } else {
+                    chunk.removeSubrange(n...)
+                    continuation.resume(returning: chunk)
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,71 @@
+import UDPipeCLib
+
+public extension UDPipe {
+    /// The token fields whose values the model interns into per-model vocabularies.
+    enum TagField: Int32, Sendable {
+        case upos = 0
+        case xpos = 1
+        case feats = 2
+        case deprel = 3
+    }
+
+    /// Returns the values of `field` seen by this model so far, indexed by vocabulary id.
+    ///
+    /// Vocabularies grow lazily as documents are processed; index `0` is always the empty string.
+    func vocabulary(for field: TagField) -> [String] {
+        let count = udpipe_vocab_size(handle, field.rawValue)
+        var out: [String] = []
+        out.reserveCapacity(count)
+        for id in 0..<count {
+            guard let c = udpipe_vocab_entry(handle, field.rawValue, id) else { break }
+            out.append(String(cString: c))
+        }
+        return out
+    }
+}
+
+/// Decodes interned tag values once per vocabulary id instead of once per token.
+///
+/// A cache lives for a single conversion, so it needs no synchronisation even when several
+/// threads convert documents of the same model at once.
+struct _TagDecodeCache {
+    private var pos: [UDPipe.POS?] = []
+    private var xpostags: [String??] = []
+    private var features: [[UDPipe.MorphFeature]?] = []
+    private var deprels: [UDPipe.Deprel??] = []
+
+    mutating func pos(_ id: UInt16, _ value: UnsafePointer<CChar>) -> UDPipe.POS {
+        Self.lookup(&pos, id) { UDPipe.POS.parse(String(cString: value)) }
+    }
+
+    mutating func xpostag(_ id: UInt16, _ value: UnsafePointer<CChar>) -> String? {
+        Self.lookup(&xpostags, id) {
+            let s = String(cString: value)
+            return s.isEmpty ? nil : s
+        }
+    }
+
+    mutating func features(_ id: UInt16, _ value: UnsafePointer<CChar>) -> [UDPipe.MorphFeature] {
+        Self.lookup(&features, id) { UDPipe.parseFeatures(String(cString: value)) }
+    }
+
+    mutating func deprel(_ id: UInt16, _ value: UnsafePointer<CChar>) -> UDPipe.Deprel? {
+        Self.lookup(&deprels, id) {
+            let s = String(cString: value)
+            return s.isEmpty ? nil : UDPipe.Deprel.parse(s)
+        }
+    }
+
+    private static func lookup<T>(_ cache: inout [T?], _ id: UInt16, _ decode: () -> T) -> T {
+        // Values that didn't fit in the vocabulary carry no id and are decoded every time.
+        guard id != UInt16(UDPIPE_NO_TAG_ID) else { return decode() }
+        let i = Int(id)
+        if i >= cache.count {
+            cache.append(contentsOf: repeatElement(nil, count: i - cache.count + 1))
+        }
+        if let v = cache[i] { return v }
+        let v = decode()
+        cache[i] = v
+        return v
+    }
+}
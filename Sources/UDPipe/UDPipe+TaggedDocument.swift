@@ -0,0 +1,154 @@
+import UDPipeCLib
+#if canImport(Darwin)
+import Darwin
+#elseif canImport(Glibc)
+import Glibc
+#endif
+
+public extension UDPipe {
+    /// A tagged document whose token fields are decoded only when they are read.
+    ///
+    /// The document keeps the native result alive, and each `Token` reads its field straight
+    /// from it, so code that only looks at a few fields (or a few tokens) doesn't pay to build
+    /// every `String`, `POS` and feature list up front. Tag values are decoded once per
+    /// document. A document is not thread-safe; use `taggedTokens` to get a `Sendable` copy.
+    final class TaggedDocument: RandomAccessCollection {
+        public typealias Index = Int
+
+        private var doc: udpipe_doc_view
+        /// Keeps the UTF-8 input alive; borrowed forms point into it.
+        private let input: _UTF8Buffer?
+        private let source: UnsafeRawPointer?
+        fileprivate var tags = _TagDecodeCache()
+
+        /// Takes ownership of `doc`, whose borrowed forms point into text `index` of `input`.
+        init(doc: udpipe_doc_view, input: _UTF8Buffer?, index: Int = 0) {
+            self.doc = doc
+            self.input = input
+            self.source = input.map { UnsafeRawPointer($0.text(at: index)) }
+        }
+
+        deinit {
+            udpipe_doc_recycle(&doc)
+        }
+
+        /// Whether the document was processed completely. Documents that couldn't be produced
+        /// at all are `.failed` and empty.
+        public var status: DocumentStatus { DocumentStatus(doc) }
+
+        public var startIndex: Int { 0 }
+        public var endIndex: Int { Int(doc.count) }
+
+        /// The sentence at `position`.
+        public subscript(position: Int) -> Sentence {
+            Sentence(document: self, view: doc.sentences![position])
+        }
+
+        /// The number of tokens in the document.
+        public var tokenCount: Int { Int(doc.token_count) }
+
+        /// Every token decoded in full, as returned by `UDPipe.tagTokens(_:doParse:)`.
+        public var taggedTokens: [[TaggedToken]] {
+            UDPipe._convertDocView(doc, source: source)
+        }
+
+        /// The tokens of one sentence.
+        public struct Sentence: RandomAccessCollection {
+            public typealias Index = Int
+
+            let document: TaggedDocument
+            let view: udpipe_sentence_view
+
+            public var startIndex: Int { 0 }
+            public var endIndex: Int { Int(view.count) }
+
+            /// The token at `position`.
+            public subscript(position: Int) -> Token {
+                Token(document: document, token: view.tokens! + position)
+            }
+        }
+
+        /// One token; every property is decoded from the native result when read.
+        public struct Token {
+            let document: TaggedDocument
+            let token: UnsafePointer<udpipe_token>
+
+            /// The 1-based index of the token within the sentence.
+            public var id: Int { Int(token.pointee.id) }
+            /// The raw text form of the token.
+            public var form: String { UDPipe._form(of: token.pointee, source: document.source) }
+            /// The lemma, or base form, of the token.
+            public var lemma: String { String(cString: token.pointee.lemma) }
+            /// The Universal Part-of-Speech (UPOS) tag.
+            public var pos: POS { document.tags.pos(token.pointee.upos_id, token.pointee.upos) }
+            /// The language-specific part-of-speech tag (XPOS).
+            public var xpostag: String? { document.tags.xpostag(token.pointee.xpostag_id, token.pointee.xpostag) }
+            /// A list of morphological features.
+            public var features: [MorphFeature] { document.tags.features(token.pointee.feats_id, token.pointee.feats) }
+            /// The index of the token which is the syntactic head of this token.
+            public var head: Int? { token.pointee.head >= 0 ? Int(token.pointee.head) : nil }
+            /// The dependency relation to the head token.
+            public var deprel: Deprel? { document.tags.deprel(token.pointee.deprel_id, token.pointee.deprel) }
+            /// The starting UTF-8 byte offset of the token in the original input string.
+            public var start: Int { Int(token.pointee.start) }
+            /// The ending UTF-8 byte offset (exclusive) of the token in the original input string.
+            public var end: Int { Int(token.pointee.end) }
+
+            /// The token with every field decoded.
+            public var taggedToken: TaggedToken {
+                var sentence = udpipe_sentence_view()
+                sentence.tokens = UnsafeMutablePointer(mutating: token)
+                sentence.count = 1
+                return UDPipe._convertSentence(sentence, source: document.source, tags: &document.tags)[0]
+            }
+        }
+    }
+
+    /// Processes the input text and returns a document that decodes tokens on access.
+    ///
+    /// - Parameters:
+    ///   - text: The text to process.
+    ///   - doParse: If `true`, performs dependency parsing as well as tagging.
+    ///   - fields: The token fields to fill in; the others are left empty and cost nothing.
+    /// - Returns: The tagged document, empty on failure.
+    func tagDocument(_ text: String, doParse: Bool = true, fields: Fields = .all) -> TaggedDocument {
+        let flags = Self._batchFlags(doParse, fields)
+        let input = _UTF8Buffer([text])
+        var doc = udpipe_doc_view()
+        guard udpipe_tag_structured_ex(handle, input.text(at: 0), input.length(at: 0), flags, &doc) == 1 else {
+            return TaggedDocument(doc: ._failed, input: nil)
+        }
+        return TaggedDocument(doc: doc, input: input)
+    }
+
+    /// Processes a batch of input texts in parallel and returns documents that decode tokens
+    /// on access.
+    ///
+    /// The texts are copied once into a single UTF-8 buffer that the documents share, and
+    /// token forms are read from it rather than copied per token.
+    ///
+    /// - Parameters:
+    ///   - batch: An array of strings to process.
+    ///   - doParse: If `true`, performs dependency parsing as well as tagging.
+    ///   - fields: The token fields to fill in; the others are left empty and cost nothing.
+    ///   - pool: The worker pool to run on. If `nil`, a process-wide pool is used.
+    /// - Returns: One document per input string; documents for texts that fail are empty (see
+    ///   `TaggedDocument.status`).
+    func tagDocuments(batch: [String], doParse: Bool = true, fields: Fields = .all,
+                      pool: WorkerPool? = nil) -> [TaggedDocument] {
+        let flags = Self._batchFlags(doParse, fields) | UInt32(UDPIPE_PARTIAL_BATCH)
+        let input = _UTF8Buffer(batch)
+        var outDocs: UnsafeMutablePointer<udpipe_doc_view>? = nil
+        var outSize = 0
+        let ok = input.withTexts { texts, lengths in
+            udpipe_tag_batch_ex(handle, pool?.handle, texts, lengths, batch.count, flags, &outDocs, &outSize)
+        }
+        guard ok == 1, let docs = outDocs, outSize == batch.count else {
+            if let docs = outDocs { udpipe_batch_recycle(docs, outSize) }
+            return batch.map { _ in TaggedDocument(doc: ._failed, input: nil) }
+        }
+        // Each document takes over its own view; only the array itself is freed here.
+        defer { free(docs) }
+        return (0..<outSize).map { TaggedDocument(doc: docs[$0], input: input, index: $0) }
+    }
+}
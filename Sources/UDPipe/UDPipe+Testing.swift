@@ -0,0 +1,12 @@
+import UDPipeCLib
+
+// Test hooks over udpipe_testing.h; compiled only in debug builds (see Package.swift).
+#if UDPIPE_TESTING
+extension UDPipe {
+    /// Makes the tagger and parser fail on every sentence containing a word spelled `form`,
+    /// or stops doing so for `nil`; for exercising the failure paths in tests.
+    func _failOnForm(_ form: String?) {
+        _ = udpipe_model_fail_on_form(handle, form)
+    }
+}
+#endif
@@ -0,0 +1,87 @@
+import UDPipeCLib
+
+public extension UDPipe {
+    /// A persistent pool of native worker threads used by the batch APIs.
+    ///
+    /// Creating threads is expensive compared to tagging a handful of short texts, so a pool is
+    /// meant to be created once and shared by every batch call. Idle workers sleep until work
+    /// arrives. Batch calls that don't specify a pool use a process-wide one instead.
+    final class WorkerPool: @unchecked Sendable {
+        let handle: udpipe_pool_t
+
+        /// Starts a new pool of worker threads.
+        ///
+        /// On multi-socket machines, workers can be kept on the CPUs and memory of their own
+        /// socket: with `numaAware`, workers are grouped by NUMA node and each node's workers
+        /// take new documents from a queue of their own, only helping other nodes when they run
+        /// out of work. Placement needs Linux; elsewhere it is skipped.
+        ///
+        /// - Parameters:
+        ///   - threadCount: The number of worker threads. Pass `0` to use one thread per hardware
+        ///     thread, or, if any placement option is given, one per CPU the pool may use.
+        ///   - cpus: The CPUs the workers may run on; `nil` for every CPU.
+        ///   - pinThreads: If `true`, pins each worker to a single CPU.
+        ///   - numaAware: If `true`, groups workers by NUMA node and keeps each on its node.
+        ///   - maxNodes: With `numaAware`, the number of nodes to use; `0` for all.
+        /// - Throws: `UDPipeError.poolCreationFailed` if the threads cannot be started or none
+        ///   of `cpus` can be used.
+        public init(threadCount: Int = 0, cpus: [Int]? = nil, pinThreads: Bool = false, numaAware: Bool = false,
+                    maxNodes: Int = 0) throws {
+            let handle: udpipe_pool_t?
+            if cpus == nil && !pinThreads && !numaAware {
+                handle = udpipe_pool_create(max(threadCount, 0))
+            } else {
+                let cpuList = (cpus ?? []).map { Int32(truncatingIfNeeded: $0) }
+                handle = cpuList.withUnsafeBufferPointer { buf in
+                    var options = udpipe_pool_options()
+                    options.num_threads = max(threadCount, 0)
+                    options.cpus = buf.baseAddress
+                    options.cpu_count = buf.count
+                    options.max_nodes = max(maxNodes, 0)
+                    options.flags = (pinThreads ? UInt32(UDPIPE_POOL_PIN_THREADS) : 0)
+                        | (numaAware ? UInt32(UDPIPE_POOL_NUMA) : 0)
+                    return udpipe_pool_create_ex(&options)
+                }
+            }
+            guard let handle else {
+                throw UDPipeError.poolCreationFailed
+            }
+            self.handle = handle
+        }
+
+        deinit {
+            udpipe_pool_free(handle)
+        }
+
+        /// The number of worker threads owned by the pool.
+        public var threadCount: Int {
+            udpipe_pool_size(handle)
+        }
+
+        /// The number of NUMA nodes the pool's workers are grouped by; 1 unless `numaAware`.
+        public var nodeCount: Int {
+            udpipe_pool_node_count(handle)
+        }
+
+        /// The number of NUMA nodes with CPUs this process may run on.
+        public static var numaNodeCount: Int {
+            udpipe_numa_node_count()
+        }
+    }
+
+    /// Gives every node of a NUMA-aware `pool` its own copy of the model.
+    ///
+    /// Each copy is loaded again from the model file by one of the pool's workers on its node,
+    /// and takes as much memory as the model itself. Batch calls on NUMA-aware pools then
+    /// tokenize, tag and parse with the copy of each worker's node. Whether that beats sharing one copy
+    /// depends on the machine; compare the native benchmark's `batch_tag_parse_numa` and
+    /// `batch_tag_parse_numa_shared` passes. Copies are kept for the lifetime of the model.
+    ///
+    /// - Parameter pool: The pool whose nodes need copies.
+    /// - Returns: `true` once every node has a copy; `false` if the model wasn't loaded from a
+    ///   file or a copy couldn't be loaded.
+    @discardableResult
+    func replicate(on pool: WorkerPool) -> Bool {
+        udpipe_model_replicate(handle, pool.handle) == 1
+    }
+}
@@ -6,8 +6,10 @@ import Glibc
 #endif
 
 /// Swift wrapper around the UDPipe NLP toolkit for tokenization, tagging, and parsing.
-public final class UDPipe {
-    private let handle: udpipe_model_t
+///
+/// A loaded model may be used from any number of threads or tasks at once.
+public final class UDPipe: @unchecked Sendable {
+    let handle: udpipe_model_t
 
     /// Loads a UDPipe model from the specified file path.
     ///
@@ -20,6 +22,30 @@ public final class UDPipe {
         self.handle = h
     }
 
+    /// Opens a UDPipe model, optionally deferring the load until the model is first used.
+    ///
+    /// With `deferLoading`, initialization only checks that the file exists; the first call
+    /// that processes text loads the model. A failed deferred load makes processing calls
+    /// return their failure value (empty results, or `nil` for `tagToConllu`).
+    ///
+    /// - Parameters:
+    ///   - modelPath: Path to the `.udpipe` model file.
+    ///   - deferLoading: If `true`, load the model on first use instead of now.
+    /// - Throws: `UDPipeError.modelLoadFailed` if the model cannot be loaded (or, when
+    ///   deferring, if the file doesn't exist).
+    public init(modelPath: String, deferLoading: Bool) throws {
+        let h = deferLoading ? udpipe_model_load_lazy(modelPath) : udpipe_model_load(modelPath)
+        guard let h else {
+            throw UDPipeError.modelLoadFailed(path: modelPath)
+        }
+        self.handle = h
+    }
+
+    /// Wraps a handle the caller holds a reference to; the new instance takes it over.
+    init(retainedHandle: udpipe_model_t) {
+        self.handle = retainedHandle
+    }
+
     deinit {
         udpipe_model_free(handle)
     }
@@ -32,49 +58,85 @@ public final class UDPipe {
     /// Processes the input text and returns rich tagged information for each token,
     /// grouped by sentence. This includes lemmas, part-of-speech tags, and dependency parsing.
     ///
-    /// - Parameter text: The text to process.
+    /// - Parameters:
+    ///   - text: The text to process.
+    ///   - doParse: If `true`, performs full dependency parsing.
+    ///   - fields: The token fields to fill in; the others are left empty and cost nothing.
     /// - Returns: An array of sentences, where each sentence is an array of `TaggedToken`s.
-    public func tagTokens(_ text: String, doParse: Bool = true) -> [[TaggedToken]] {
-        var doc = udpipe_doc_view(sentences: nil, count: 0, arena: nil)
-        let ok = text.withCString { cstr in
-            udpipe_tag_structured(handle, cstr, doParse ? 1 : 0, &doc)
+    public func tagTokens(_ text: String, doParse: Bool = true, fields: Fields = .all) -> [[TaggedToken]] {
+        let flags = Self._batchFlags(doParse, fields)
+        var text = text
+        return text.withUTF8 { buf in
+            var doc = udpipe_doc_view()
+            let source = UnsafeRawPointer(buf.baseAddress)
+            guard udpipe_tag_structured_ex(handle, source?.assumingMemoryBound(to: CChar.self), buf.count, flags, &doc) == 1
+            else { return [] }
+            defer { udpipe_doc_recycle(&doc) }
+
+            return Self._convertDocView(doc, source: source)
         }
-        guard ok == 1 else { return [] }
-        defer { udpipe_free_doc(&doc) }
+    }
+
+    /// Processes one long text using every thread of `pool`, for lower latency on book-length
+    /// inputs.
+    ///
+    /// Sentences are tagged and parsed by the pool's workers while the rest of the text is
+    /// still being tokenized, and reassembled in order, so the result is identical to
+    /// `tagTokens(_:doParse:)`. Short texts gain nothing from this.
+    ///
+    /// - Parameters:
+    ///   - text: The text to process.
+    ///   - doParse: If `true`, performs full dependency parsing.
+    ///   - fields: The token fields to fill in; the others are left empty and cost nothing.
+    ///   - pool: The worker pool to spread the text over.
+    /// - Returns: An array of sentences, where each sentence is an array of `TaggedToken`s.
+    public func tagTokens(_ text: String, doParse: Bool = true, fields: Fields = .all,
+                          pool: WorkerPool) -> [[TaggedToken]] {
+        var text = text
+        return text.withUTF8 { buf in
+            var doc = udpipe_doc_view()
+            let source = UnsafeRawPointer(buf.baseAddress)
+            guard udpipe_tag_structured_parallel(handle, pool.handle, source?.assumingMemoryBound(to: CChar.self),
+                                                 buf.count, Self._batchFlags(doParse, fields), &doc) == 1
+            else { return [] }
+            defer { udpipe_doc_recycle(&doc) }
 
-        return _convertDocView(doc)
+            return Self._convertDocView(doc, source: source)
+        }
     }
 
     /// Processes a batch of input texts in parallel and returns rich tagged information for each.
     ///
-    /// This method is highly optimized for server-side use and will use multiple threads
-    /// to process the batch concurrently, taking advantage of multi-core CPUs.
+    /// This method is highly optimized for server-side use and runs the batch concurrently on a
+    /// persistent pool of native worker threads, taking advantage of multi-core CPUs.
     ///
     /// - Parameters:
     ///   - batch: An array of strings to process.
     ///   - doParse: If `true`, performs full dependency parsing. If `false`, only performs
     ///              tokenization, lemmatization, and part-of-speech tagging.
+    ///   - fields: The token fields to fill in; the others are left empty and cost nothing.
+    ///   - pool: The worker pool to run on. If `nil`, a process-wide pool is used.
     /// - Returns: An array of results, where each result corresponds to an input string and contains
-    ///            an array of sentences, which in turn contain an array of `TaggedToken`s.
-    public func tagTokens(batch: [String], doParse: Bool = true) -> [[[TaggedToken]]] {
-        // Convert Swift [String] to C-compatible strings and keep ownership for freeing.
-        let ownedCStrings: [UnsafeMutablePointer<CChar>] = batch.map { s in
-            if let p = strdup(s) { return p }
-            return strdup("")!
-        }
-        var constCStringPtrs: [UnsafePointer<CChar>?] = ownedCStrings.map { UnsafePointer($0) }
-        defer { for ptr in ownedCStrings { free(ptr) } }
+    ///            an array of sentences, which in turn contain an array of `TaggedToken`s. A text
+    ///            that can't be processed gets an empty result without affecting the others;
+    ///            use `tagTokensWithStatus(batch:)` to find out why.
+    public func tagTokens(batch: [String], doParse: Bool = true, fields: Fields = .all,
+                          pool: WorkerPool? = nil) -> [[[TaggedToken]]] {
+        // One contiguous UTF-8 copy of the whole batch, rather than one C string per text.
+        let input = _UTF8Buffer(batch)
 
         var outDocs: UnsafeMutablePointer<udpipe_doc_view>? = nil
         var outSize: Int = 0
 
-        let ok = constCStringPtrs.withUnsafeMutableBufferPointer { buf -> Int32 in
-            guard let base = buf.baseAddress else { return 0 }
-            return udpipe_tag_batch(
+        let flags = Self._batchFlags(doParse, fields) | UInt32(UDPIPE_PARTIAL_BATCH)
+        let ok = input.withTexts { texts, lengths in
+            udpipe_tag_batch_ex(
                 self.handle,
-                base,
+                pool?.handle,
+                texts,
+                lengths,
                 batch.count,
-                doParse ? 1 : 0,
+                flags,
                 &outDocs,
                 &outSize
             )
@@ -82,19 +144,20 @@ public final class UDPipe {
 
         guard ok == 1, let docs = outDocs, outSize == batch.count else {
             if let docs = outDocs {
-                udpipe_free_batch(docs, outSize)
+                udpipe_batch_recycle(docs, outSize)
             }
             return Array(repeating: [], count: batch.count)
         }
 
-        defer { udpipe_free_batch(docs, outSize) }
+        defer { udpipe_batch_recycle(docs, outSize) }
 
         var batchResult: [[[TaggedToken]]] = []
         batchResult.reserveCapacity(outSize)
 
         for i in 0..<outSize {
             let docView = docs.advanced(by: i).pointee
-            let taggedSentences = self._convertDocView(docView)
+            // Borrowed forms point into `input`, which stays alive until we return.
+            let taggedSentences = Self._convertDocView(docView, source: UnsafeRawPointer(input.text(at: i)))
             batchResult.append(taggedSentences)
         }
 
@@ -125,9 +188,47 @@ public final class UDPipe {
         return _tokenize(text, options: options).flatMap { $0.tokens }
     }
 
+    /// Tokenizes a batch of texts in parallel on a pool of native worker threads.
+    ///
+    /// Each text is tokenized by one worker, so throughput grows with the thread count for
+    /// batches of many documents. Only forms and offsets are produced, which makes this much
+    /// cheaper than tagging.
+    ///
+    /// - Parameters:
+    ///   - batch: An array of strings to tokenize.
+    ///   - options: Optional tokenizer options for the underlying UDPipe engine.
+    ///   - pool: The worker pool to run on. If `nil`, a process-wide pool is used.
+    /// - Returns: The sentences of each input string, in input order; empty for a text that
+    ///            can't be tokenized.
+    public func tokenize(batch: [String], options: String? = nil, pool: WorkerPool? = nil) -> [[Sentence]] {
+        let input = _UTF8Buffer(batch)
+        var outDocs: UnsafeMutablePointer<udpipe_token_doc>? = nil
+        var outSize = 0
+
+        let flags = UInt32(UDPIPE_BORROW_FORMS | UDPIPE_PARTIAL_BATCH)
+        let ok = input.withTexts { texts, lengths in
+            let run = { (o: UnsafePointer<CChar>?) in
+                udpipe_tokenize_batch(self.handle, pool?.handle, texts, lengths, batch.count, o, flags,
+                                      &outDocs, &outSize)
+            }
+            return options.map { $0.withCString(run) } ?? run(nil)
+        }
+
+        guard ok == 1, let docs = outDocs, outSize == batch.count else {
+            if let docs = outDocs {
+                udpipe_token_batch_recycle(docs, outSize)
+            }
+            return Array(repeating: [], count: batch.count)
+        }
+        defer { udpipe_token_batch_recycle(docs, outSize) }
+
+        // Borrowed forms point into `input`, which stays alive until we return.
+        return (0..<outSize).map { Self._convertTokenDoc(docs[$0], source: UnsafeRawPointer(input.text(at: $0))) }
+    }
+
     /// Internal tokenization implementation that always returns sentences.
     private func _tokenize(_ text: String, options: String? = nil) -> [Sentence] {
-        var doc = udpipe_doc_view(sentences: nil, count: 0, arena: nil)
+        var doc = udpipe_doc_view()
         let ok: Int32 = text.withCString { cstr in
             if let opt = options {
                 return opt.withCString { o in udpipe_tokenize_structured(self.handle, cstr, o, &doc) }
@@ -138,22 +239,9 @@ public final class UDPipe {
 
         }
         guard ok == 1 else { return [] }
-        defer { udpipe_free_doc(&doc) }
-
-        var out: [Sentence] = []
-        out.reserveCapacity(Int(doc.count))
-        for i in 0..<Int(doc.count) {
-            let sv = doc.sentences!.advanced(by: i).pointee
-            var toks: [Token] = []
-            toks.reserveCapacity(Int(sv.count))
-            for j in 0..<Int(sv.count) {
-                let ctok = sv.tokens!.advanced(by: j).pointee
-                let tok = Token(text: String(cString: ctok.form), start: Int(ctok.start), end: Int(ctok.end))
-                toks.append(tok)
-            }
-            out.append(Sentence(tokens: toks))
-        }
-        return out
+        defer { udpipe_doc_recycle(&doc) }
+
+        return Self._convertTokenizedDoc(doc)
     }
 
     /// Tags the input text and returns the output in CoNLL-U format.
@@ -166,47 +254,155 @@ public final class UDPipe {
         return String(cString: c)
     }
 
-    // MARK: - Private Helpers
+    // MARK: - Internal Helpers
+
+    /// Returns the form of `ctok`, reading it from `source` (the UTF-8 input the document was
+    /// built from) when the token's form was borrowed with `UDPIPE_BORROW_FORMS`.
+    @inline(__always)
+    static func _form(of ctok: udpipe_token, source: UnsafeRawPointer?) -> String {
+        _form(ctok.form, start: Int(ctok.start), end: Int(ctok.end), source: source)
+    }
+
+    @inline(__always)
+    static func _form(_ form: UnsafePointer<CChar>?, start: Int, end: Int, source: UnsafeRawPointer?) -> String {
+        if let form { return String(cString: form) }
+        guard let source else { return "" }
+        let bytes = UnsafeRawBufferPointer(start: source + start, count: end - start)
+        return String(decoding: bytes, as: UTF8.self)
+    }
+
+    /// Converts a tokenize-only C `udpipe_doc_view` into Swift `Sentence`s.
+    ///
+    /// - Parameter source: The input text, required if the document was built with `UDPIPE_BORROW_FORMS`.
+    static func _convertTokenizedDoc(_ doc: udpipe_doc_view, source: UnsafeRawPointer? = nil) -> [Sentence] {
+        _timedConversion {
+            var out: [Sentence] = []
+            out.reserveCapacity(Int(doc.count))
+            for i in 0..<Int(doc.count) {
+                let sv = doc.sentences!.advanced(by: i).pointee
+                var toks: [Token] = []
+                toks.reserveCapacity(Int(sv.count))
+                for j in 0..<Int(sv.count) {
+                    let ctok = sv.tokens!.advanced(by: j).pointee
+                    let tok = Token(text: _form(of: ctok, source: source), start: Int(ctok.start), end: Int(ctok.end))
+                    toks.append(tok)
+                }
+                out.append(Sentence(tokens: toks))
+            }
+            return out
+        }
+    }
+
+    /// Converts a `udpipe_token_doc` from `udpipe_tokenize_batch` into Swift `Sentence`s.
+    ///
+    /// - Parameter source: The input text, required if the document was built with `UDPIPE_BORROW_FORMS`.
+    static func _convertTokenDoc(_ doc: udpipe_token_doc, source: UnsafeRawPointer? = nil) -> [Sentence] {
+        _timedConversion {
+            guard let tokens = doc.tokens, let offsets = doc.sentence_offsets else { return [] }
+            var out: [Sentence] = []
+            out.reserveCapacity(Int(doc.count))
+            for i in 0..<Int(doc.count) {
+                var toks: [Token] = []
+                toks.reserveCapacity(Int(offsets[i + 1] - offsets[i]))
+                for j in Int(offsets[i])..<Int(offsets[i + 1]) {
+                    let ctok = tokens[j]
+                    let start = Int(ctok.start), end = Int(ctok.end)
+                    let text = _form(ctok.form, start: start, end: end, source: source)
+                    toks.append(Token(text: text, start: start, end: end))
+                }
+                out.append(Sentence(tokens: toks))
+            }
+            return out
+        }
+    }
 
     /// Converts a C `udpipe_doc_view` into a Swift `[[TaggedToken]]`.
-    private func _convertDocView(_ doc: udpipe_doc_view) -> [[TaggedToken]] {
-        var result: [[TaggedToken]] = []
+    ///
+    /// - Parameter source: The input text, required if the document was built with `UDPIPE_BORROW_FORMS`.
+    static func _convertDocView(_ doc: udpipe_doc_view, source: UnsafeRawPointer? = nil) -> [[TaggedToken]] {
         guard doc.count > 0, let sentences = doc.sentences else { return [] }
-        result.reserveCapacity(Int(doc.count))
-
-        for i in 0..<Int(doc.count) {
-            let sv = sentences.advanced(by: i).pointee
-            var sent: [TaggedToken] = []
-            guard sv.count > 0, let tokens = sv.tokens else {
-                result.append([])
-                continue
+        return _timedConversion {
+            var result: [[TaggedToken]] = []
+            result.reserveCapacity(Int(doc.count))
+            var tags = _TagDecodeCache()
+
+            for i in 0..<Int(doc.count) {
+                result.append(_convertSentence(sentences.advanced(by: i).pointee, source: source, tags: &tags))
             }
-            sent.reserveCapacity(Int(sv.count))
-
-            for j in 0..<Int(sv.count) {
-                let ctok = tokens.advanced(by: j).pointee
-                let form = String(cString: ctok.form)
-                let lemma = String(cString: ctok.lemma)
-                let uposS = String(cString: ctok.upos)
-                let xpostagS = String(cString: ctok.xpostag)
-                let featsS = String(cString: ctok.feats)
-                let deprelS = String(cString: ctok.deprel)
-                let tok = TaggedToken(
-                    id: Int(ctok.id),
-                    form: form,
-                    lemma: lemma,
-                    pos: POS.parse(uposS),
-                    xpostag: xpostagS.isEmpty ? nil : xpostagS,
-                    features: UDPipe.parseFeatures(featsS),
-                    head: ctok.head >= 0 ? Int(ctok.head) : nil,
-                    deprel: deprelS.isEmpty ? nil : Deprel.parse(deprelS),
-                    start: Int(ctok.start),
-                    end: Int(ctok.end)
-                )
-                sent.append(tok)
+            return result
+        }
+    }
+
+    /// Converts one C `udpipe_sentence_view` into Swift `TaggedToken`s.
+    static func _convertSentence(
+        _ sv: udpipe_sentence_view,
+        source: UnsafeRawPointer?,
+        tags: inout _TagDecodeCache
+    ) -> [TaggedToken] {
+        guard sv.count > 0, let tokens = sv.tokens else { return [] }
+        var sent: [TaggedToken] = []
+        sent.reserveCapacity(Int(sv.count))
+
+        for j in 0..<Int(sv.count) {
+            let ctok = tokens.advanced(by: j).pointee
+            let form = _form(of: ctok, source: source)
+            let lemma = String(cString: ctok.lemma)
+            let tok = TaggedToken(
+                id: Int(ctok.id),
+                form: form,
+                lemma: lemma,
+                pos: tags.pos(ctok.upos_id, ctok.upos),
+                xpostag: tags.xpostag(ctok.xpostag_id, ctok.xpostag),
+                features: tags.features(ctok.feats_id, ctok.feats),
+                head: ctok.head >= 0 ? Int(ctok.head) : nil,
+                deprel: tags.deprel(ctok.deprel_id, ctok.deprel),
+                start: Int(ctok.start),
+                end: Int(ctok.end)
+            )
+            sent.append(tok)
+        }
+        return sent
+    }
+}
+
+/// UTF-8 copies of a batch of strings, packed back to back in one allocation, to pass to the
+/// batch calls with explicit lengths.
+final class _UTF8Buffer {
+    private let base: UnsafeMutablePointer<CChar>
+    private var texts: [UnsafePointer<CChar>?] = []
+    private let lengths: [Int]
+
+    init(_ strings: [String]) {
+        lengths = strings.map { $0.utf8.count }
+        base = .allocate(capacity: max(lengths.reduce(0, +), 1))
+        texts.reserveCapacity(strings.count)
+        var offset = 0
+        for var string in strings {
+            let start = base + offset
+            offset += string.withUTF8 { buf in
+                if let src = buf.baseAddress {
+                    UnsafeMutableRawPointer(start).copyMemory(from: src, byteCount: buf.count)
+                }
+                return buf.count
             }
-            result.append(sent)
+            texts.append(UnsafePointer(start))
+        }
+    }
+
+    deinit {
+        base.deallocate()
+    }
+
+    var count: Int { lengths.count }
+
+    func text(at i: Int) -> UnsafePointer<CChar> { texts[i]! }
+
+    func length(at i: Int) -> Int { lengths[i] }
+
+    /// Calls `body` with the text pointers and lengths laid out as the C batch calls take them.
+    func withTexts<R>(_ body: (UnsafeMutablePointer<UnsafePointer<CChar>?>?, UnsafePointer<Int>?) -> R) -> R {
+        lengths.withUnsafeBufferPointer { lengths in
+            texts.withUnsafeMutableBufferPointer { texts in body(texts.baseAddress, lengths.baseAddress) }
         }
-        return result
     }
 }
@@ -0,0 +1,189 @@
+#include "binary_format.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace binary_format {
+
+namespace {
+
+constexpr char MAGIC[4] = {'U', 'D', 'P', 'B'};
+// The smallest encoded token: eight one-byte varints and two empty strings.
+constexpr size_t MIN_TOKEN_BYTES = 11;
+
+void put_varint(std::string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+uint64_t zigzag(int64_t v) { return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63); }
+int64_t unzigzag(uint64_t v) { return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); }
+
+void put_string(std::string& out, const std::string& s) {
+    // An embedded NUL would end the string early for the reader; it can't come
+    // out of the tokenizer, but keep the format well-formed regardless.
+    out.append(s.c_str(), std::strlen(s.c_str()));
+    out.push_back('\0');
+}
+
+// Bounds-checked cursor over an untrusted buffer.
+class Reader {
+    const char* p_;
+    const char* end_;
+
+public:
+    Reader(const char* data, size_t len) : p_(data), end_(data + len) {}
+
+    size_t remaining() const { return end_ - p_; }
+
+    bool varint(uint64_t& v) {
+        v = 0;
+        for (int shift = 0; shift < 64 && p_ < end_; shift += 7) {
+            const uint8_t byte = static_cast<uint8_t>(*p_++);
+            v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    bool string(const char*& s) {
+        const void* nul = std::memchr(p_, '\0', remaining());
+        if (!nul) return false;
+        s = p_;
+        p_ = static_cast<const char*>(nul) + 1;
+        return true;
+    }
+
+    bool bytes(const char* expected, size_t n) {
+        if (remaining() < n || std::memcmp(p_, expected, n) != 0) return false;
+        p_ += n;
+        return true;
+    }
+
+    bool byte(uint8_t& b) {
+        if (p_ == end_) return false;
+        b = static_cast<uint8_t>(*p_++);
+        return true;
+    }
+};
+
+} // namespace
+
+Encoder::Encoder(unsigned stages) : stages_(stages) {
+    static const std::string empty;
+    for (int field = 0; field < UDPIPE_TAG_FIELD_COUNT; ++field) intern(field, empty);
+}
+
+uint64_t Encoder::intern(int field, const std::string& value) {
+    Table& table = tables_[field];
+    auto it = table.ids.find(value);
+    if (it != table.ids.end()) return it->second;
+    it = table.ids.emplace(value, table.values.size()).first;
+    table.values.push_back(&it->first);
+    return it->second;
+}
+
+void Encoder::begin_sentence(size_t token_count) {
+    ++sentences_;
+    put_varint(body_, token_count);
+}
+
+void Encoder::add_token(const udpipe_token& t, const std::string& form, const std::string& lemma,
+                        const std::string* const tags[UDPIPE_TAG_FIELD_COUNT]) {
+    ++tokens_;
+    put_varint(body_, static_cast<uint64_t>(t.id));
+    put_varint(body_, static_cast<uint64_t>(t.head + 1));
+    put_varint(body_, zigzag(static_cast<int64_t>(t.start) - static_cast<int64_t>(previous_start_)));
+    put_varint(body_, t.end - t.start);
+    put_varint(body_, t.flags);
+    previous_start_ = t.start;
+    put_string(body_, form);
+    put_string(body_, lemma);
+    for (int field = 0; field < UDPIPE_TAG_FIELD_COUNT; ++field) put_varint(body_, intern(field, *tags[field]));
+}
+
+char* Encoder::finish(size_t* out_len) {
+    std::string head(MAGIC, sizeof(MAGIC));
+    head.push_back(static_cast<char>(VERSION));
+    head.push_back(static_cast<char>(stages_));
+    put_varint(head, sentences_);
+    put_varint(head, tokens_);
+    for (const Table& table : tables_) {
+        put_varint(head, table.values.size());
+        for (const std::string* value : table.values) put_string(head, *value);
+    }
+
+    char* out = static_cast<char*>(std::malloc(head.size() + body_.size()));
+    if (!out) return nullptr;
+    std::memcpy(out, head.data(), head.size());
+    std::memcpy(out + head.size(), body_.data(), body_.size());
+    *out_len = head.size() + body_.size();
+    return out;
+}
+
+bool decode(const char* data, size_t len, std::vector<udpipe_token>& toks,
+            std::vector<udpipe_sentence_view>& sentences) {
+    toks.clear();
+    sentences.clear();
+    Reader r(data, len);
+    uint8_t version = 0, stages = 0;
+    uint64_t sentence_count = 0, token_count = 0;
+    if (!r.bytes(MAGIC, sizeof(MAGIC)) || !r.byte(version) || version != VERSION || !r.byte(stages) ||
+        !r.varint(sentence_count) || !r.varint(token_count)) {
+        return false;
+    }
+
+    std::vector<const char*> tables[UDPIPE_TAG_FIELD_COUNT];
+    for (auto& table : tables) {
+        uint64_t size = 0;
+        if (!r.varint(size) || size == 0 || size > r.remaining()) return false;
+        table.resize(size);
+        for (const char*& value : table) {
+            if (!r.string(value)) return false;
+        }
+    }
+
+    if (sentence_count > r.remaining() || token_count > r.remaining() / MIN_TOKEN_BYTES) return false;
+    toks.reserve(token_count);
+    sentences.reserve(sentence_count);
+    size_t previous_start = 0;
+    for (uint64_t i = 0; i < sentence_count; ++i) {
+        uint64_t count = 0;
+        if (!r.varint(count) || count > token_count - toks.size()) return false;
+        udpipe_sentence_view view{};
+        view.offset = toks.size();
+        view.count = count;
+        for (uint64_t j = 0; j < count; ++j) {
+            uint64_t id, head, start_delta, length, flags;
+            if (!r.varint(id) || !r.varint(head) || !r.varint(start_delta) || !r.varint(length) || !r.varint(flags) ||
+                id > INT32_MAX || head > INT32_MAX || flags > UINT16_MAX) {
+                return false;
+            }
+            udpipe_token t{};
+            t.id = static_cast<int>(id);
+            t.head = static_cast<int>(head) - 1;
+            // Unsigned arithmetic, so a corrupt delta wraps instead of overflowing.
+            t.start = previous_start + static_cast<size_t>(unzigzag(start_delta));
+            t.end = t.start + length;
+            t.flags = static_cast<uint16_t>(flags);
+            previous_start = t.start;
+            if (!r.string(t.form) || !r.string(t.lemma)) return false;
+            const char** values[UDPIPE_TAG_FIELD_COUNT] = {&t.upos, &t.xpostag, &t.feats, &t.deprel};
+            uint16_t* ids[UDPIPE_TAG_FIELD_COUNT] = {&t.upos_id, &t.xpostag_id, &t.feats_id, &t.deprel_id};
+            for (int field = 0; field < UDPIPE_TAG_FIELD_COUNT; ++field) {
+                uint64_t index = 0;
+                if (!r.varint(index) || index >= tables[field].size()) return false;
+                *values[field] = tables[field][index];
+                *ids[field] = index < UDPIPE_NO_TAG_ID ? static_cast<uint16_t>(index) : UDPIPE_NO_TAG_ID;
+            }
+            toks.push_back(t);
+        }
+        sentences.push_back(view);
+    }
+    return toks.size() == token_count && r.remaining() == 0;
+}
+
+} // namespace binary_format
@@ -0,0 +1,72 @@
+#pragma once
+
+// Internal C++ helper shared by the wrapper translation units.
+// Not part of the C interface exported through module.modulemap.
+
+#include "udpipe_wrapper.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The binary document format behind udpipe_tag_binary / udpipe_binary_open.
+//
+//   "UDPB" version:u8 stages:u8
+//   sentence_count:varint token_count:varint
+//   4 tag tables (UPOS, XPOS, FEATS, DEPREL): size:varint, then NUL-terminated
+//     values; entry 0 is always ""
+//   per sentence: tokens:varint, then per token
+//     id:varint head+1:varint start-previous_start:zigzag end-start:varint
+//     flags:varint form\0 lemma\0 upos xpos feats deprel:varint (table indices)
+//
+// Varints are unsigned LEB128. Strings are NUL-terminated so that a reader can
+// point tokens straight into the buffer. Tag tables are local to the document;
+// a value is written once however many tokens carry it.
+namespace binary_format {
+
+constexpr uint8_t VERSION = 1;
+
+// Serialises one document word by word. Values are interned as they come and
+// the header and tag tables are prepended by `finish`.
+class Encoder {
+public:
+    explicit Encoder(unsigned stages);
+
+    void begin_sentence(size_t token_count);
+
+    // Appends a token. Only id, head, start, end and flags are read from `t`;
+    // the strings are given separately. `tags` holds the UPOS, XPOS, FEATS and
+    // DEPREL values.
+    void add_token(const udpipe_token& t, const std::string& form, const std::string& lemma,
+                   const std::string* const tags[UDPIPE_TAG_FIELD_COUNT]);
+
+    // Returns the complete document in a buffer allocated with malloc, or NULL
+    // on allocation failure.
+    char* finish(size_t* out_len);
+
+private:
+    struct Table {
+        std::unordered_map<std::string, uint64_t> ids;
+        std::vector<const std::string*> values; // keys of `ids`, in id order
+    };
+
+    unsigned stages_;
+    size_t sentences_ = 0;
+    size_t tokens_ = 0;
+    size_t previous_start_ = 0;
+    std::string body_;
+    Table tables_[UDPIPE_TAG_FIELD_COUNT];
+
+    uint64_t intern(int field, const std::string& value);
+};
+
+// Parses `len` bytes of `data` into tokens and sentence views whose strings point
+// into `data`; sentence views carry offsets only. Tag ids are indices into the
+// document's own tables. Returns false if the buffer is malformed or of another
+// version.
+bool decode(const char* data, size_t len, std::vector<udpipe_token>& toks,
+            std::vector<udpipe_sentence_view>& sentences);
+
+} // namespace binary_format
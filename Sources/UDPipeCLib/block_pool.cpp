@@ -0,0 +1,214 @@
+#include "block_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+namespace block_pool {
+
+namespace {
+
+constexpr size_t CLASSES = 8; // MIN_BLOCK << 0 .. MIN_BLOCK << 7 == MAX_BLOCK
+static_assert(MIN_BLOCK << (CLASSES - 1) == MAX_BLOCK, "size classes must end at MAX_BLOCK");
+
+// Idle bytes a thread keeps per size class (at least two blocks), and idle bytes
+// shared by all threads in total.
+constexpr size_t THREAD_CLASS_BYTES = 1 << 20;
+constexpr size_t SHARED_BYTES = 32 << 20;
+
+std::atomic<uint64_t> in_use{0};
+std::atomic<uint64_t> high_water{0};
+std::atomic<uint64_t> cached{0};
+
+size_t class_of(size_t size) {
+    size_t c = 0;
+    while ((MIN_BLOCK << c) < size) ++c;
+    return c;
+}
+
+size_t thread_limit(size_t c) { return std::max<size_t>(2, THREAD_CLASS_BYTES / (MIN_BLOCK << c)); }
+
+struct Freelists {
+    std::vector<char*> blocks[CLASSES];
+
+    // Frees everything; returns the number of bytes freed.
+    size_t clear() {
+        size_t bytes = 0;
+        for (size_t c = 0; c < CLASSES; ++c) {
+            for (char* block : blocks[c]) std::free(block);
+            bytes += blocks[c].size() * (MIN_BLOCK << c);
+            blocks[c].clear();
+        }
+        return bytes;
+    }
+};
+
+struct ThreadCache;
+
+// The shared freelists and the registry of thread caches, for `trim`.
+struct Shared {
+    std::mutex mutex;
+    Freelists lists;
+    size_t bytes = 0;
+    std::vector<ThreadCache*> threads;
+};
+
+// Never destroyed: threads may exit (and hand their blocks over) after static
+// destructors have run.
+Shared& shared() {
+    static Shared* s = new Shared();
+    return *s;
+}
+
+// A thread's freelists. The mutex is only contended when `trim` runs.
+struct ThreadCache {
+    std::mutex mutex;
+    Freelists lists;
+    size_t recent_arena_bytes = 0;
+
+    ThreadCache() {
+        Shared& s = shared();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.threads.push_back(this);
+    }
+
+    // Hands the idle blocks to the shared freelists (or frees them) and
+    // unregisters the cache.
+    ~ThreadCache() {
+        Shared& s = shared();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.threads.erase(std::find(s.threads.begin(), s.threads.end(), this));
+        size_t freed = 0;
+        for (size_t c = 0; c < CLASSES; ++c) {
+            const size_t size = MIN_BLOCK << c;
+            for (char* block : lists.blocks[c]) {
+                if (s.bytes + size <= SHARED_BYTES) {
+                    s.lists.blocks[c].push_back(block);
+                    s.bytes += size;
+                } else {
+                    std::free(block);
+                    freed += size;
+                }
+            }
+            lists.blocks[c].clear();
+        }
+        cached.fetch_sub(freed, std::memory_order_relaxed);
+    }
+};
+
+ThreadCache& thread_cache() {
+    thread_local ThreadCache cache;
+    return cache;
+}
+
+void note_in_use(size_t bytes) {
+    const uint64_t now = in_use.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    uint64_t peak = high_water.load(std::memory_order_relaxed);
+    while (now > peak && !high_water.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {}
+}
+
+} // namespace
+
+char* acquire(size_t size, size_t* capacity) {
+    if (size > MAX_BLOCK) {
+        char* block = static_cast<char*>(std::malloc(size));
+        if (!block) return nullptr;
+        *capacity = size;
+        note_in_use(size);
+        return block;
+    }
+
+    const size_t c = class_of(size);
+    const size_t class_size = MIN_BLOCK << c;
+    char* block = nullptr;
+    {
+        ThreadCache& t = thread_cache();
+        std::lock_guard<std::mutex> lock(t.mutex);
+        if (!t.lists.blocks[c].empty()) {
+            block = t.lists.blocks[c].back();
+            t.lists.blocks[c].pop_back();
+        }
+    }
+    if (!block) {
+        Shared& s = shared();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        if (!s.lists.blocks[c].empty()) {
+            block = s.lists.blocks[c].back();
+            s.lists.blocks[c].pop_back();
+            s.bytes -= class_size;
+        }
+    }
+    if (block) {
+        cached.fetch_sub(class_size, std::memory_order_relaxed);
+    } else {
+        block = static_cast<char*>(std::malloc(class_size));
+        if (!block) return nullptr;
+    }
+    *capacity = class_size;
+    note_in_use(class_size);
+    return block;
+}
+
+void release(char* block, size_t capacity, bool reuse) {
+    if (!block) return;
+    in_use.fetch_sub(capacity, std::memory_order_relaxed);
+    if (!reuse || capacity > MAX_BLOCK || capacity < MIN_BLOCK || (capacity & (capacity - 1)) != 0) {
+        std::free(block);
+        return;
+    }
+
+    const size_t c = class_of(capacity);
+    {
+        ThreadCache& t = thread_cache();
+        std::lock_guard<std::mutex> lock(t.mutex);
+        if (t.lists.blocks[c].size() < thread_limit(c)) {
+            t.lists.blocks[c].push_back(block);
+            cached.fetch_add(capacity, std::memory_order_relaxed);
+            return;
+        }
+    }
+    {
+        Shared& s = shared();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        if (s.bytes + capacity <= SHARED_BYTES) {
+            s.lists.blocks[c].push_back(block);
+            s.bytes += capacity;
+            cached.fetch_add(capacity, std::memory_order_relaxed);
+            return;
+        }
+    }
+    std::free(block);
+}
+
+void note_arena_size(size_t bytes) {
+    size_t& recent = thread_cache().recent_arena_bytes;
+    // Exponential average over the last few documents.
+    recent = recent ? (recent * 3 + bytes) / 4 : bytes;
+}
+
+size_t suggested_block_size() {
+    const size_t recent = thread_cache().recent_arena_bytes;
+    return MIN_BLOCK << class_of(std::min(std::max(recent, MIN_BLOCK), MAX_BLOCK));
+}
+
+void stats(udpipe_arena_pool_stats* out) {
+    out->bytes_in_use = in_use.load(std::memory_order_relaxed);
+    out->high_water = high_water.load(std::memory_order_relaxed);
+    out->bytes_cached = cached.load(std::memory_order_relaxed);
+}
+
+void trim() {
+    Shared& s = shared();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    size_t freed = s.lists.clear();
+    s.bytes = 0;
+    for (ThreadCache* t : s.threads) {
+        std::lock_guard<std::mutex> thread_lock(t->mutex);
+        freed += t->lists.clear();
+    }
+    cached.fetch_sub(freed, std::memory_order_relaxed);
+}
+
+} // namespace block_pool
@@ -0,0 +1,44 @@
+#pragma once
+
+// Internal C++ helper shared by the wrapper translation units.
+// Not part of the C interface exported through module.modulemap.
+
+#include "udpipe_wrapper.h"
+
+#include <cstddef>
+
+// Process-wide pool of the memory blocks document arenas are carved from.
+//
+// Block sizes are powers of two from MIN_BLOCK to MAX_BLOCK. Each thread keeps a
+// small freelist per size, so a steady stream of documents reuses the same
+// blocks without touching malloc or a shared lock; blocks beyond a thread's
+// limit go to a shared freelist, and beyond that back to malloc. Requests
+// larger than MAX_BLOCK bypass the pool.
+//
+// The pool also tracks the size of recent documents on each thread, so a new
+// arena can start with a block large enough for a typical document.
+namespace block_pool {
+
+constexpr size_t MIN_BLOCK = 8192;
+constexpr size_t MAX_BLOCK = 1 << 20;
+
+// Returns a block of at least `size` bytes and stores its actual size in
+// `*capacity`, or returns NULL on allocation failure.
+char* acquire(size_t size, size_t* capacity);
+
+// Gives back a block from `acquire`. With `reuse`, it is kept for later
+// `acquire` calls (if the freelists have room); otherwise it is freed.
+void release(char* block, size_t capacity, bool reuse);
+
+// Records that an arena has been released after `bytes` were allocated from it.
+void note_arena_size(size_t bytes);
+
+// The first block size for a new arena on this thread.
+size_t suggested_block_size();
+
+void stats(udpipe_arena_pool_stats* out);
+
+// Frees every idle block, on all threads.
+void trim();
+
+} // namespace block_pool
@@ -0,0 +1,134 @@
+#include "cpu_topology.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace cpu_topology {
+
+namespace {
+
+// Parses the non-negative decimal number at `pos` and advances past it.
+bool parse_number(const std::string& s, size_t& pos, int& out) {
+    if (pos >= s.size() || !std::isdigit(static_cast<unsigned char>(s[pos]))) return false;
+    long value = 0;
+    while (pos < s.size() && std::isdigit(static_cast<unsigned char>(s[pos]))) {
+        value = value * 10 + (s[pos++] - '0');
+        if (value > 1 << 20) return false;
+    }
+    out = static_cast<int>(value);
+    return true;
+}
+
+std::vector<Node> single_node() {
+    Node node{0, {}};
+    const unsigned threads = std::max(std::thread::hardware_concurrency(), 1u);
+    for (unsigned cpu = 0; cpu < threads; ++cpu) node.cpus.push_back(static_cast<int>(cpu));
+    return {node};
+}
+
+#if defined(__linux__)
+std::vector<Node> read_nodes() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    const bool have_mask = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+    std::vector<Node> nodes;
+    DIR* dir = opendir("/sys/devices/system/node");
+    if (!dir) return nodes;
+    while (dirent* entry = readdir(dir)) {
+        const std::string name = entry->d_name;
+        size_t pos = 4;
+        int id = 0;
+        if (name.compare(0, 4, "node") != 0 || !parse_number(name, pos, id) || pos != name.size()) continue;
+
+        std::ifstream in("/sys/devices/system/node/" + name + "/cpulist");
+        std::string list((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        Node node{id, {}};
+        for (int cpu : parse_cpu_list(list)) {
+            if (!have_mask || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))) node.cpus.push_back(cpu);
+        }
+        if (!node.cpus.empty()) nodes.push_back(std::move(node));
+    }
+    closedir(dir);
+    std::sort(nodes.begin(), nodes.end(), [](const Node& a, const Node& b) { return a.id < b.id; });
+    return nodes;
+}
+#endif
+
+} // namespace
+
+std::vector<int> parse_cpu_list(const std::string& list) {
+    std::vector<int> cpus;
+    size_t end = list.find_last_not_of(" \t\r\n");
+    const std::string s = end == std::string::npos ? std::string() : list.substr(0, end + 1);
+    for (size_t pos = 0; pos < s.size();) {
+        int first = 0, last = 0;
+        if (!parse_number(s, pos, first)) return {};
+        last = first;
+        if (pos < s.size() && s[pos] == '-') {
+            ++pos;
+            if (!parse_number(s, pos, last) || last < first) return {};
+        }
+        for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+        if (pos < s.size() && s[pos++] != ',') return {};
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+const std::vector<Node>& nodes() {
+    static const std::vector<Node> topology = []() {
+#if defined(__linux__)
+        std::vector<Node> found = read_nodes();
+        if (!found.empty()) return found;
+#endif
+        return single_node();
+    }();
+    return topology;
+}
+
+int node_of(int cpu) {
+    for (const Node& node : nodes()) {
+        if (std::binary_search(node.cpus.begin(), node.cpus.end(), cpu)) return node.id;
+    }
+    return -1;
+}
+
+int current_node() {
+    if (nodes().size() == 1) return nodes()[0].id;
+#if defined(__linux__)
+    const int cpu = sched_getcpu();
+    if (cpu >= 0) return node_of(cpu);
+#endif
+    return -1;
+}
+
+bool pin_current_thread(const std::vector<int>& cpus) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    bool any = false;
+    for (int cpu : cpus) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE) continue;
+        CPU_SET(cpu, &set);
+        any = true;
+    }
+    return any && pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
+
+} // namespace cpu_topology
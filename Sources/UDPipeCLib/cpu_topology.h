@@ -0,0 +1,39 @@
+#pragma once
+
+// Internal C++ helper shared by the wrapper translation units.
+// Not part of the C interface exported through module.modulemap.
+
+#include <string>
+#include <vector>
+
+// The machine's NUMA nodes and the CPUs on each, and thread placement.
+//
+// On Linux the topology is read once from /sys/devices/system/node and
+// restricted to the CPUs the process may run on (its affinity mask, e.g. as
+// set by taskset or a cgroup). Elsewhere, or if /sys can't be read, the
+// machine is reported as a single node 0 holding every hardware thread, and
+// threads can't be pinned.
+namespace cpu_topology {
+
+struct Node {
+    int id;
+    std::vector<int> cpus; // ascending
+};
+
+// Parses a kernel CPU list such as "0-3,8,10-11". Returns an empty list if it is malformed.
+std::vector<int> parse_cpu_list(const std::string& list);
+
+// Every node with at least one usable CPU, in ascending id order. Never empty.
+const std::vector<Node>& nodes();
+
+// The node `cpu` belongs to, or -1 if it is not a usable CPU.
+int node_of(int cpu);
+
+// The node the calling thread is running on right now, or -1 if unknown.
+int current_node();
+
+// Restricts the calling thread to `cpus`. Returns false if that is not supported
+// or none of `cpus` is usable.
+bool pin_current_thread(const std::vector<int>& cpus);
+
+} // namespace cpu_topology
@@ -0,0 +1,153 @@
+#include "model_registry.h"
+
+#include <sys/stat.h>
+
+ModelRegistry::ModelRegistry(size_t memory_budget) : budget_(memory_budget) {
+    loader_ = std::thread([this]() { loader_loop(); });
+}
+
+ModelRegistry::~ModelRegistry() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    queue_cv_.notify_all();
+    loader_.join();
+    for (auto& entry : entries_) {
+        udpipe_model_free(entry.second.model);
+    }
+}
+
+bool ModelRegistry::stat_file(const std::string& path, FileStamp& stamp) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return false;
+#if defined(__APPLE__)
+    stamp.mtime_ns = int64_t(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    stamp.mtime_ns = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+    stamp.size = static_cast<size_t>(st.st_size);
+    return true;
+}
+
+udpipe_model_t ModelRegistry::acquire(const std::string& path) {
+    FileStamp stamp;
+    const bool exists = stat_file(path, stamp);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        auto it = entries_.find(path);
+        if (it != entries_.end() && it->second.model) {
+            Entry& e = it->second;
+            if (exists && !(e.stamp == stamp) && !e.loading) {
+                // The file changed; serve the loaded model while the new one loads.
+                e.loading = true;
+                queue_.push_back(path);
+                queue_cv_.notify_one();
+            }
+            e.last_used = ++clock_;
+            udpipe_model_retain(e.model);
+            return e.model;
+        }
+        if (!exists) return nullptr;
+        if (it == entries_.end() || !it->second.loading) break;
+        loaded_cv_.wait(lock);
+    }
+
+    // First load of `path`: do it on this thread, so that different models
+    // requested at the same time load in parallel.
+    entries_[path].loading = true;
+    load(lock, path);
+    auto it = entries_.find(path);
+    if (it == entries_.end()) return nullptr;
+    it->second.last_used = ++clock_;
+    udpipe_model_retain(it->second.model);
+    return it->second.model;
+}
+
+bool ModelRegistry::preload(const std::string& path) {
+    FileStamp stamp;
+    if (!stat_file(path, stamp)) return false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry& e = entries_[path];
+    if (e.loading || (e.model && e.stamp == stamp)) return true;
+    e.loading = true;
+    queue_.push_back(path);
+    queue_cv_.notify_one();
+    return true;
+}
+
+size_t ModelRegistry::memory_usage() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return used_;
+}
+
+size_t ModelRegistry::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t n = 0;
+    for (const auto& entry : entries_) {
+        if (entry.second.model) ++n;
+    }
+    return n;
+}
+
+void ModelRegistry::load(std::unique_lock<std::mutex>& lock, const std::string& path) {
+    lock.unlock();
+    FileStamp stamp;
+    udpipe_model_t model = nullptr;
+    if (stat_file(path, stamp)) model = udpipe_model_load(path.c_str());
+    lock.lock();
+
+    auto it = entries_.find(path);
+    Entry& e = it->second;
+    e.loading = false;
+    // Models to drop, freed once the lock is released; callers still using one keep it alive.
+    std::vector<udpipe_model_t> released;
+    if (model) {
+        // Swap in the new model.
+        if (e.model) {
+            released.push_back(e.model);
+            used_ -= e.stamp.size;
+        }
+        e.model = model;
+        e.stamp = stamp;
+        used_ += stamp.size;
+        evict(path, released);
+    } else if (!e.model) {
+        entries_.erase(it);
+    }
+    loaded_cv_.notify_all();
+
+    if (!released.empty()) {
+        lock.unlock();
+        for (udpipe_model_t m : released) udpipe_model_free(m);
+        lock.lock();
+    }
+}
+
+void ModelRegistry::loader_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        queue_cv_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+        if (stopping_) return;
+        std::string path = std::move(queue_.front());
+        queue_.pop_front();
+        load(lock, path);
+    }
+}
+
+void ModelRegistry::evict(const std::string& keep, std::vector<udpipe_model_t>& victims) {
+    while (budget_ != 0 && used_ > budget_) {
+        auto victim = entries_.end();
+        for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+            const Entry& e = it->second;
+            if (!e.model || e.loading || it->first == keep) continue;
+            if (victim == entries_.end() || e.last_used < victim->second.last_used) victim = it;
+        }
+        if (victim == entries_.end()) return;
+        used_ -= victim->second.stamp.size;
+        victims.push_back(victim->second.model);
+        entries_.erase(victim);
+    }
+}
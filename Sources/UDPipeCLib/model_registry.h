@@ -0,0 +1,85 @@
+#pragma once
+
+// Internal C++ helper shared by the wrapper translation units.
+// Not part of the C interface exported through module.modulemap.
+
+#include "udpipe_wrapper.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Process-level cache of loaded models, keyed by file path.
+//
+// Each path is loaded at most once; callers asking for a path that is being
+// loaded wait for that load instead of starting their own. Handles are
+// refcounted (udpipe_model_retain / udpipe_model_free), so the registry can drop
+// its reference at any time while callers keep using theirs. When a model
+// file's modification time or size changes, the next `acquire` keeps returning
+// the loaded model and reloads the file on a background thread; once the new
+// model is ready it replaces the old one, which is freed when its last user
+// lets go.
+//
+// With a memory budget, least recently acquired models are dropped until the
+// total fits. Memory is accounted by model file size, which tracks the decoded
+// size closely enough for budgeting.
+class ModelRegistry {
+public:
+    // `memory_budget` in bytes; 0 means unlimited.
+    explicit ModelRegistry(size_t memory_budget);
+    ~ModelRegistry();
+
+    ModelRegistry(const ModelRegistry&) = delete;
+    ModelRegistry& operator=(const ModelRegistry&) = delete;
+
+    // Returns a retained handle for the model at `path`, loading it first if
+    // needed, or NULL if it can't be loaded.
+    udpipe_model_t acquire(const std::string& path);
+
+    // Starts loading (or refreshing) `path` in the background. Returns false if
+    // the file doesn't exist.
+    bool preload(const std::string& path);
+
+    size_t memory_usage() const;
+    size_t size() const;
+
+private:
+    struct FileStamp {
+        int64_t mtime_ns = 0;
+        size_t size = 0;
+        bool operator==(const FileStamp& o) const { return mtime_ns == o.mtime_ns && size == o.size; }
+    };
+
+    struct Entry {
+        udpipe_model_t model = nullptr;
+        FileStamp stamp; // of the file `model` was loaded from
+        bool loading = false;
+        uint64_t last_used = 0;
+    };
+
+    static bool stat_file(const std::string& path, FileStamp& stamp);
+
+    // Loads `path` with the lock released and installs the result.
+    void load(std::unique_lock<std::mutex>& lock, const std::string& path);
+    void loader_loop();
+    // Drops least recently used models other than `keep` until the budget is met,
+    // adding them to `victims` for the caller to free once it has released the lock.
+    void evict(const std::string& keep, std::vector<udpipe_model_t>& victims);
+
+    mutable std::mutex mutex_;
+    std::condition_variable loaded_cv_; // `acquire` waits here for a first load
+    std::condition_variable queue_cv_;  // the loader thread waits here for work
+    std::unordered_map<std::string, Entry> entries_;
+    std::deque<std::string> queue_;     // background loads
+    size_t budget_;
+    size_t used_ = 0;
+    uint64_t clock_ = 0;
+    bool stopping_ = false;
+    std::thread loader_;
+};
@@ -0,0 +1,81 @@
+#include "sentence_cache.h"
+
+#include <algorithm>
+
+using namespace ufal::udpipe;
+
+SentenceCache::SentenceCache(size_t capacity) : shard_count_(std::min(std::max<size_t>(capacity, 1), SHARDS)) {
+    // Split the capacity exactly, so that the shards together never hold more than it.
+    for (size_t i = 0; i < shard_count_; ++i) {
+        shards_[i].capacity = capacity / shard_count_ + (i < capacity % shard_count_ ? 1 : 0);
+    }
+}
+
+bool SentenceCache::lookup(unsigned stages, sentence& s, std::string& key) {
+    // Forms are separated by a unit separator, multiword tokens follow after a
+    // record separator; neither can occur inside a token.
+    key.clear();
+    key.push_back(static_cast<char>('0' + stages));
+    for (size_t i = 1; i < s.words.size(); ++i) {
+        key += s.words[i].form;
+        key.push_back('\x1f');
+    }
+    for (const auto& mwt : s.multiword_tokens) {
+        key.push_back('\x1e');
+        key += std::to_string(mwt.id_first);
+        key.push_back('-');
+        key += std::to_string(mwt.id_last);
+        key.push_back('\x1f');
+        key += mwt.form;
+    }
+
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+
+    const std::vector<Annotation>& annotations = it->second->second;
+    for (size_t i = 0; i < annotations.size(); ++i) {
+        const Annotation& a = annotations[i];
+        word& w = s.words[i + 1];
+        w.lemma = a.lemma;
+        w.upostag = a.upostag;
+        w.xpostag = a.xpostag;
+        w.feats = a.feats;
+        w.head = a.head;
+        w.deprel = a.deprel;
+    }
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void SentenceCache::insert(std::string&& key, const sentence& s) {
+    std::vector<Annotation> annotations;
+    annotations.reserve(s.words.empty() ? 0 : s.words.size() - 1);
+    for (size_t i = 1; i < s.words.size(); ++i) {
+        const word& w = s.words[i];
+        annotations.push_back(Annotation{w.lemma, w.upostag, w.xpostag, w.feats, w.deprel, w.head});
+    }
+
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.index.count(key)) return; // another worker got there first
+    shard.lru.emplace_front(std::move(key), std::move(annotations));
+    shard.index.emplace(shard.lru.front().first, shard.lru.begin());
+    entries_.fetch_add(1, std::memory_order_relaxed);
+    while (shard.lru.size() > shard.capacity) {
+        shard.index.erase(shard.lru.back().first);
+        shard.lru.pop_back();
+        entries_.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void SentenceCache::stats(udpipe_cache_stats* out) const {
+    out->hits = hits_.load(std::memory_order_relaxed);
+    out->misses = misses_.load(std::memory_order_relaxed);
+    out->entries = entries_.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+// Internal C++ helper shared by the wrapper translation units.
+// Not part of the C interface exported through module.modulemap.
+
+#include "udpipe_wrapper.h"
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Bounded LRU cache of tagging/parsing results per tokenized sentence, for
+// traffic that repeats the same sentences (boilerplate, headlines, templated
+// notifications). The key is the sentence's word forms and multiword token
+// structure together with the stages that were run, so a hit reproduces
+// exactly what the tagger and parser would have produced. Offsets are not part
+// of the entry: they come from the sentence being annotated.
+//
+// The cache is split into independently locked shards so that batch workers
+// rarely contend. The capacity is divided exactly among them; a cache smaller
+// than the shard count uses one shard per entry.
+class SentenceCache {
+public:
+    // `capacity` is the total number of sentences kept across all shards.
+    explicit SentenceCache(size_t capacity);
+
+    SentenceCache(const SentenceCache&) = delete;
+    SentenceCache& operator=(const SentenceCache&) = delete;
+
+    // Stores the cache key of `s` in `key` and, on a hit, copies the cached
+    // annotations into the words of `s`. Returns whether it was a hit.
+    bool lookup(unsigned stages, ufal::udpipe::sentence& s, std::string& key);
+
+    // Caches the annotations of the processed sentence `s` under `key`.
+    void insert(std::string&& key, const ufal::udpipe::sentence& s);
+
+    void stats(udpipe_cache_stats* out) const;
+
+private:
+    struct Annotation {
+        std::string lemma, upostag, xpostag, feats, deprel;
+        int head;
+    };
+
+    struct Shard {
+        using Entry = std::pair<std::string, std::vector<Annotation>>;
+        std::mutex mutex;
+        size_t capacity = 0;
+        std::list<Entry> lru; // most recently used first
+        // Keys point into the list nodes, which never move.
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+    };
+
+    static constexpr size_t SHARDS = 16;
+
+    Shard& shard_for(const std::string& key) { return shards_[std::hash<std::string>()(key) % shard_count_]; }
+
+    size_t shard_count_; // shards in use, the first ones of `shards_`
+    Shard shards_[SHARDS];
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<size_t> entries_{0};
+};
@@ -0,0 +1,152 @@
+#include "stage_stats.h"
+
+#include <cstring>
+
+#ifdef UDPIPE_STATS
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+// Counters of one thread, laid out like udpipe_stats. Only the owning thread
+// writes them; snapshots read them concurrently.
+struct ThreadStats {
+    std::atomic<uint64_t> values[sizeof(udpipe_stats) / sizeof(uint64_t)] = {};
+
+    void add(size_t index, uint64_t amount) {
+        values[index].store(values[index].load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+};
+
+constexpr size_t STAGE_VALUES = sizeof(udpipe_stage_stats) / sizeof(uint64_t);
+constexpr size_t SENTENCES_INDEX = offsetof(udpipe_stats, sentences) / sizeof(uint64_t);
+constexpr size_t TOKENS_INDEX = offsetof(udpipe_stats, tokens) / sizeof(uint64_t);
+constexpr size_t ARENA_BYTES_INDEX = offsetof(udpipe_stats, arena_bytes) / sizeof(uint64_t);
+
+// udpipe_stats viewed as a flat array of counters.
+uint64_t* counters(udpipe_stats& s) { return reinterpret_cast<uint64_t*>(&s); }
+
+struct StatsRegistry {
+    std::mutex mutex;
+    std::vector<ThreadStats*> threads;
+    udpipe_stats exited{};  // folded in from threads that have ended
+    udpipe_stats baseline{}; // totals at the last reset
+
+    void sum(udpipe_stats& out) {
+        out = exited;
+        for (ThreadStats* t : threads) {
+            for (size_t i = 0; i < sizeof(udpipe_stats) / sizeof(uint64_t); ++i) {
+                counters(out)[i] += t->values[i].load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+// Never destroyed: threads may still exit (and fold in their counters) after
+// static destructors have run.
+StatsRegistry& registry() {
+    static StatsRegistry* r = new StatsRegistry();
+    return *r;
+}
+
+// Registers the thread's counters on first use and folds them into
+// `exited` when the thread ends.
+struct ThreadStatsHolder {
+    ThreadStats stats;
+
+    ThreadStatsHolder() {
+        StatsRegistry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.threads.push_back(&stats);
+    }
+
+    ~ThreadStatsHolder() {
+        StatsRegistry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (size_t i = 0; i < sizeof(udpipe_stats) / sizeof(uint64_t); ++i) {
+            counters(r.exited)[i] += stats.values[i].load(std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < r.threads.size(); ++i) {
+            if (r.threads[i] == &stats) {
+                r.threads[i] = r.threads.back();
+                r.threads.pop_back();
+                break;
+            }
+        }
+    }
+};
+
+ThreadStats& thread_stats() {
+    thread_local ThreadStatsHolder holder;
+    return holder.stats;
+}
+
+size_t histogram_bucket(uint64_t nanoseconds) {
+    size_t bucket = 0;
+    while (nanoseconds > 1 && bucket + 1 < UDPIPE_STATS_BUCKETS) {
+        nanoseconds >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+} // namespace
+
+void stats_record(int stage, uint64_t nanoseconds) {
+    if (stage < 0 || stage >= UDPIPE_STAT_STAGE_COUNT) return;
+    ThreadStats& t = thread_stats();
+    const size_t base = stage * STAGE_VALUES;
+    t.add(base + offsetof(udpipe_stage_stats, count) / sizeof(uint64_t), 1);
+    t.add(base + offsetof(udpipe_stage_stats, total_ns) / sizeof(uint64_t), nanoseconds);
+    t.add(base + offsetof(udpipe_stage_stats, histogram) / sizeof(uint64_t) + histogram_bucket(nanoseconds), 1);
+}
+
+void stats_count(uint64_t sentences, uint64_t tokens) {
+    ThreadStats& t = thread_stats();
+    t.add(SENTENCES_INDEX, sentences);
+    t.add(TOKENS_INDEX, tokens);
+}
+
+void stats_arena_bytes(uint64_t bytes) {
+    thread_stats().add(ARENA_BYTES_INDEX, bytes);
+}
+
+extern "C" int udpipe_stats_enabled(void) { return 1; }
+
+extern "C" int udpipe_stats_snapshot(udpipe_stats* out_stats) {
+    if (!out_stats) return 0;
+    StatsRegistry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.sum(*out_stats);
+    for (size_t i = 0; i < sizeof(udpipe_stats) / sizeof(uint64_t); ++i) {
+        counters(*out_stats)[i] -= counters(r.baseline)[i];
+    }
+    return 1;
+}
+
+extern "C" void udpipe_stats_reset(void) {
+    StatsRegistry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.sum(r.baseline);
+}
+
+extern "C" void udpipe_stats_record(int stage, uint64_t nanoseconds) {
+    stats_record(stage, nanoseconds);
+}
+
+#else
+
+extern "C" int udpipe_stats_enabled(void) { return 0; }
+
+extern "C" int udpipe_stats_snapshot(udpipe_stats* out_stats) {
+    if (out_stats) std::memset(out_stats, 0, sizeof(*out_stats));
+    return 0;
+}
+
+extern "C" void udpipe_stats_reset(void) {}
+
+extern "C" void udpipe_stats_record(int, uint64_t) {}
+
+#endif
@@ -0,0 +1,55 @@
+#pragma once
+
+// Internal C++ helper shared by the wrapper translation units.
+// Not part of the C interface exported through module.modulemap.
+
+#include "udpipe_wrapper.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Stage timing and counters behind udpipe_stats_snapshot. Everything here is
+// compiled only with UDPIPE_STATS; otherwise the macros expand to nothing, so
+// uninstrumented builds carry no clock reads or counter updates.
+//
+// Each thread writes to its own counters with plain relaxed stores (there is a
+// single writer per counter), and a snapshot sums the counters of all live
+// threads plus those folded in by threads that have exited.
+
+#ifdef UDPIPE_STATS
+
+void stats_record(int stage, uint64_t nanoseconds);
+void stats_count(uint64_t sentences, uint64_t tokens);
+void stats_arena_bytes(uint64_t bytes);
+
+// Records the time between construction and destruction with stats_record.
+class StageTimer {
+    int stage_;
+    std::chrono::steady_clock::time_point start_;
+
+public:
+    explicit StageTimer(int stage) : stage_(stage), start_(std::chrono::steady_clock::now()) {}
+    ~StageTimer() {
+        auto elapsed = std::chrono::steady_clock::now() - start_;
+        stats_record(stage_, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+};
+
+#define UDPIPE_STATS_CONCAT_(a, b) a##b
+#define UDPIPE_STATS_CONCAT(a, b) UDPIPE_STATS_CONCAT_(a, b)
+// Times the rest of the enclosing scope as `stage`.
+#define UDPIPE_STATS_SCOPE(stage) StageTimer UDPIPE_STATS_CONCAT(stage_timer_, __LINE__)(stage)
+#define UDPIPE_STATS_COUNT(sentences, tokens) stats_count(sentences, tokens)
+#define UDPIPE_STATS_ARENA_BYTES(bytes) stats_arena_bytes(bytes)
+
+#else
+
+#define UDPIPE_STATS_SCOPE(stage) ((void)0)
+#define UDPIPE_STATS_COUNT(sentences, tokens) ((void)0)
+#define UDPIPE_STATS_ARENA_BYTES(bytes) ((void)0)
+
+#endif
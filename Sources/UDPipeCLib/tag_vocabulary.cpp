@@ -0,0 +1,47 @@
+#include "tag_vocabulary.h"
+
+#include <mutex>
+
+TagVocabulary::TagVocabulary() {
+    for (auto& field : fields_) {
+        field.values.emplace_back();
+        field.ids.emplace(std::string(), 0);
+    }
+}
+
+uint16_t TagVocabulary::intern(int field, const std::string& value, const char** str) {
+    Field& f = fields_[field];
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = f.ids.find(value);
+        if (it != f.ids.end()) {
+            *str = f.values[it->second].c_str();
+            return it->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto it = f.ids.find(value); // another thread may have added it meanwhile
+    if (it != f.ids.end()) {
+        *str = f.values[it->second].c_str();
+        return it->second;
+    }
+    if (f.values.size() >= NO_ID) return NO_ID;
+
+    uint16_t id = static_cast<uint16_t>(f.values.size());
+    f.values.push_back(value);
+    f.ids.emplace(value, id);
+    *str = f.values.back().c_str();
+    return id;
+}
+
+size_t TagVocabulary::size(int field) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return fields_[field].values.size();
+}
+
+const char* TagVocabulary::entry(int field, size_t id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    const Field& f = fields_[field];
+    return id < f.values.size() ? f.values[id].c_str() : nullptr;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+// Internal C++ helper shared by the wrapper translation units.
+// Not part of the C interface exported through module.modulemap.
+
+#include "udpipe_wrapper.h"
+
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+// Per-model intern tables for the closed-set token fields (UPOS, XPOS, FEATS,
+// DEPREL). Values are added on first sight and never removed, so the returned
+// C strings stay valid for as long as the model is loaded. Id 0 of every field
+// is the empty string.
+class TagVocabulary {
+public:
+    static constexpr uint16_t NO_ID = UDPIPE_NO_TAG_ID;
+
+    TagVocabulary();
+
+    TagVocabulary(const TagVocabulary&) = delete;
+    TagVocabulary& operator=(const TagVocabulary&) = delete;
+
+    // Returns the id of `value` in `field`, adding it if it is new, and stores the
+    // interned string in `*str`. Returns NO_ID (and leaves `*str` untouched) once
+    // the field has run out of ids.
+    uint16_t intern(int field, const std::string& value, const char** str);
+
+    size_t size(int field) const;
+
+    // Interned string for `id`, or NULL if `id` is out of range.
+    const char* entry(int field, size_t id) const;
+
+private:
+    struct Field {
+        std::unordered_map<std::string, uint16_t> ids;
+        // std::deque never moves its elements, so c_str() pointers stay valid.
+        std::deque<std::string> values;
+    };
+
+    mutable std::shared_mutex mutex_;
+    Field fields_[UDPIPE_TAG_FIELD_COUNT];
+};
+
+// Unsynchronised front cache over a TagVocabulary, owned by a single thread
+// for the duration of one or more documents. Repeated values are resolved
+// without touching the shared table's lock.
+class TagInterner {
+public:
+    explicit TagInterner(TagVocabulary& vocabulary) : vocabulary_(vocabulary) {}
+
+    // Same contract as TagVocabulary::intern.
+    uint16_t intern(int field, const std::string& value, const char** str) {
+        auto& cache = cache_[field];
+        auto it = cache.find(value);
+        if (it != cache.end()) {
+            *str = it->second.second;
+            return it->second.first;
+        }
+        uint16_t id = vocabulary_.intern(field, value, str);
+        if (id != TagVocabulary::NO_ID) cache.emplace(value, std::make_pair(id, *str));
+        return id;
+    }
+
+private:
+    TagVocabulary& vocabulary_;
+    std::unordered_map<std::string, std::pair<uint16_t, const char*>> cache_[UDPIPE_TAG_FIELD_COUNT];
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+// Test hooks. Declared and compiled only with UDPIPE_TESTING, which Package.swift defines
+// for debug builds; release builds carry none of this.
+
+#include "udpipe_wrapper.h"
+
+#ifdef UDPIPE_TESTING
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Fault injection
+// ---------------
+// For testing how callers handle failures: make the tagger and parser of `model` fail on
+// every sentence containing a word whose form is `form`, with the error "injected failure".
+// NULL or an empty string turns this off. Returns 1 on success, 0 on failure.
+int udpipe_model_fail_on_form(udpipe_model_t model, const char* form);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UDPIPE_TESTING
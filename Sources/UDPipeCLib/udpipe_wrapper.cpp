@@ -1,35 +1,87 @@
 #include "udpipe_wrapper.h"
+#include "binary_format.h"
+#include "block_pool.h"
+#include "cpu_topology.h"
+#include "model_registry.h"
+#include "sentence_cache.h"
+#include "stage_stats.h"
+#include "tag_vocabulary.h"
+#include "udpipe_testing.h"
+#include "worker_pool.h"
 
+#include <algorithm>
 #include <memory>
+#include <istream>
 #include <sstream>
 #include <string>
 #include <vector>
+#include <deque>
 #include <cstring>
 #include <cstdlib>
-#include <thread>
 #include <atomic>
+#include <mutex>
+#include <thread>
+#include <cerrno>
+#include <exception>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using namespace ufal::udpipe;
 
 // A simple arena for allocating many small strings efficiently.
 // This avoids the overhead of calling malloc for every single token feature.
+// Blocks come from block_pool, and a new arena starts with blocks sized after
+// the documents recently processed on its thread, so a typical document fits
+// in one block.
 class StringArena {
+    struct Block {
+        char* data;
+        size_t capacity;
+    };
+
     // We allocate memory in blocks.
-    std::vector<char*> blocks_;
+    std::vector<Block> blocks_;
     // Current block and allocation pointer.
     char* current_block_ = nullptr;
+    size_t current_capacity_ = 0;
     size_t current_offset_ = 0;
     size_t block_size_ = 0;
+    // Bytes handed out since the arena was created or last reset.
+    size_t used_ = 0;
 
-    static constexpr size_t DEFAULT_BLOCK_SIZE = 8192;
+    // Starts a new current block of at least `size` bytes. Returns false on
+    // allocation failure.
+    bool new_block(size_t size) {
+        size_t capacity = 0;
+        char* block = block_pool::acquire(size, &capacity);
+        if (!block) return false;
+        blocks_.push_back({block, capacity});
+        UDPIPE_STATS_ARENA_BYTES(capacity);
+        current_block_ = block;
+        current_capacity_ = capacity;
+        current_offset_ = 0;
+        return true;
+    }
+
+    void release_blocks(bool reuse) {
+        if (used_) block_pool::note_arena_size(used_);
+        for (const Block& b : blocks_) block_pool::release(b.data, b.capacity, reuse);
+        blocks_.clear();
+        current_block_ = nullptr;
+        current_capacity_ = 0;
+        current_offset_ = 0;
+        used_ = 0;
+    }
 
 public:
-    StringArena(size_t block_size = DEFAULT_BLOCK_SIZE) : block_size_(block_size) {}
+    StringArena() : block_size_(block_pool::suggested_block_size()) {}
 
     ~StringArena() {
-        for (char* block : blocks_) {
-            std::free(block);
-        }
+        release_blocks(false);
     }
 
     // No copy/move semantics for simplicity
@@ -44,22 +96,18 @@ public:
             current_offset_ += align - (current_offset_ % align);
         }
 
-        if (current_block_ == nullptr || (current_offset_ + required) > block_size_) {
-            size_t new_block_size = std::max(block_size_, required);
-            current_block_ = static_cast<char*>(std::malloc(new_block_size));
-            if (!current_block_) {
+        if (current_block_ == nullptr || (current_offset_ + required) > current_capacity_) {
+            if (!new_block(std::max(block_size_, required))) {
                 // Fallback for allocation failure.
                 static char empty_str[] = "";
                 return empty_str;
             }
-            blocks_.push_back(current_block_);
-            current_offset_ = 0;
-            block_size_ = new_block_size;
         }
 
         char* ptr = current_block_ + current_offset_;
         std::memcpy(ptr, s.c_str(), s.length() + 1);
         current_offset_ += required;
+        used_ += required;
         return ptr;
     }
 
@@ -67,6 +115,124 @@ public:
     char* allocate_empty() {
         return allocate("");
     }
+
+    // Allocate `size` uninitialised bytes aligned to `align` (a power of two).
+    // Requests larger than half a block get a block of their own, so one big
+    // array doesn't waste the rest of the current block or inflate the block size.
+    // Returns NULL on allocation failure.
+    void* allocate_bytes(size_t size, size_t align) {
+        if (size > block_size_ / 2) {
+            size_t capacity = 0;
+            char* block = block_pool::acquire(size, &capacity);
+            if (block) {
+                // Keep the current block current: it most likely still has room.
+                blocks_.push_back({block, capacity});
+                UDPIPE_STATS_ARENA_BYTES(capacity);
+                used_ += size;
+            }
+            return block;
+        }
+        size_t offset = (current_offset_ + align - 1) & ~(align - 1);
+        if (current_block_ == nullptr || offset + size > current_capacity_) {
+            if (!new_block(block_size_)) return nullptr;
+            offset = 0;
+        }
+        current_offset_ = offset + size;
+        used_ += size;
+        return current_block_ + offset;
+    }
+
+    // Releases everything allocated so far, keeping the current block for reuse
+    // so that a steady flow of similar-sized allocations doesn't hit malloc.
+    void reset() {
+        for (const Block& b : blocks_) {
+            if (b.data != current_block_) block_pool::release(b.data, b.capacity, true);
+        }
+        blocks_.erase(std::remove_if(blocks_.begin(), blocks_.end(),
+                                     [this](const Block& b) { return b.data != current_block_; }),
+                      blocks_.end());
+        current_offset_ = 0;
+        used_ = 0;
+    }
+
+    // Hands every block back to block_pool for reuse and empties the arena.
+    void recycle() {
+        release_blocks(true);
+    }
+};
+
+static model* load_model_file(const char* path);
+
+// NUMA node ids up to which udpipe_model_replicate can place copies of a model.
+static constexpr size_t MAX_REPLICA_NODES = 64;
+
+// Idle tokenizers, all built from one copy of a model with the same options, for
+// reuse (see checkout_reader and TokenizerCheckout).
+struct ReaderPool {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<input_format>> idle;
+};
+
+// State attached to a loaded model; udpipe_model_t points at one of these.
+struct ModelHandle {
+    std::unique_ptr<model> m;
+    TagVocabulary vocabulary;
+    std::atomic<size_t> refs{1}; // see udpipe_model_retain
+    // Set for models opened with udpipe_model_load_lazy; `m` is loaded from it on first use.
+    std::string deferred_path;
+    std::once_flag load_once;
+    // Idle tokenizers built from `m`.
+    ReaderPool readers;
+    // Optional, see udpipe_model_set_sentence_cache. Accessed with std::atomic_load/store
+    // so it can be replaced while other threads process text.
+    std::shared_ptr<SentenceCache> sentence_cache;
+#ifdef UDPIPE_TESTING
+    // Optional, see udpipe_model_fail_on_form; accessed like `sentence_cache`, and only
+    // loaded when `fails_on_form` is set.
+    std::shared_ptr<const std::string> failing_form;
+    std::atomic<bool> fails_on_form{false};
+#endif
+    // The file the model was loaded from by udpipe_model_load, for udpipe_model_replicate.
+    std::string path;
+    // The NUMA node the model was loaded on, or -1 if unknown.
+    int home_node = -1;
+    // Copies of `m` loaded on other NUMA nodes by udpipe_model_replicate, by node id.
+    // Each is set once and freed with the handle.
+    std::atomic<model*> replicas[MAX_REPLICA_NODES] = {};
+    // Idle tokenizers built from each replica, so that a node's tokenizers read its own copy.
+    ReaderPool replica_readers[MAX_REPLICA_NODES];
+    std::mutex replicate_mutex;
+
+    ~ModelHandle() {
+        for (size_t i = 0; i < MAX_REPLICA_NODES; ++i) {
+            replica_readers[i].idle.clear(); // before the model they were built from
+            delete replicas[i].load();
+        }
+    }
+
+    // The model, loading it first if it was deferred. NULL if that load failed.
+    model* get() {
+        if (!deferred_path.empty()) {
+            std::call_once(load_once, [this]() {
+                home_node = cpu_topology::current_node();
+                m.reset(load_model_file(deferred_path.c_str()));
+            });
+        }
+        return m.get();
+    }
+
+    // The copy of the model local to NUMA node `node`, falling back to `get()`. If
+    // `pool` is given, it receives the idle tokenizers of the copy returned.
+    model* for_node(int node, ReaderPool** pool = nullptr) {
+        if (node >= 0 && static_cast<size_t>(node) < MAX_REPLICA_NODES) {
+            if (model* r = replicas[node].load(std::memory_order_acquire)) {
+                if (pool) *pool = &replica_readers[node];
+                return r;
+            }
+        }
+        if (pool) *pool = &readers;
+        return get();
+    }
 };
 
 extern "C" const char* udpipe_version(void) {
@@ -79,22 +245,174 @@ extern "C" const char* udpipe_version(void) {
     return v.c_str();
 }
 
+// Read-only stream buffer over a block of memory, used to hand a model image to
+// `model::load(std::istream&)` without copying it.
+class MemoryStreamBuf : public std::streambuf {
+public:
+    MemoryStreamBuf(const char* data, size_t size) {
+        char* p = const_cast<char*>(data);
+        setg(p, p, p + size);
+    }
+};
+
+static ModelHandle* wrap_model(model* m, int home_node) {
+    if (!m) return nullptr;
+    auto h = new ModelHandle();
+    h->m.reset(m);
+    h->home_node = home_node;
+    return h;
+}
+
+static model* load_model_from_memory(const void* data, size_t size) {
+    MemoryStreamBuf buf(static_cast<const char*>(data), size);
+    std::istream is(&buf);
+    return model::load(is);
+}
+
+// Loads the model through a read-only mapping of the file. The decoder reads the
+// image sequentially, once, so the pages come straight from the page cache (and
+// are shared with other processes loading the same file) instead of being copied
+// through an ifstream buffer. Returns NULL, without touching `*mapped`, if the
+// file can't be mapped.
+static model* load_model_mapped(const char* path, bool* mapped) {
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        ::close(fd);
+        return nullptr;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) return nullptr;
+    ::madvise(data, size, MADV_SEQUENTIAL);
+
+    *mapped = true;
+    model* m = load_model_from_memory(data, size);
+    ::munmap(data, size);
+    return m;
+}
+
+static model* load_model_file(const char* path) {
+    bool mapped = false;
+    model* m = load_model_mapped(path, &mapped);
+    if (!m && !mapped) m = model::load(path);
+    return m;
+}
+
 extern "C" udpipe_model_t udpipe_model_load(const char* model_path) {
     if (!model_path) return nullptr;
-    model* m = model::load(model_path);
-    return static_cast<udpipe_model_t>(m);
+    const int node = cpu_topology::current_node();
+    ModelHandle* h = wrap_model(load_model_file(model_path), node);
+    if (h) h->path = model_path;
+    return static_cast<udpipe_model_t>(h);
+}
+
+extern "C" udpipe_model_t udpipe_model_load_lazy(const char* model_path) {
+    if (!model_path) return nullptr;
+    struct stat st;
+    if (::stat(model_path, &st) != 0 || !S_ISREG(st.st_mode)) return nullptr;
+    auto h = new ModelHandle();
+    h->deferred_path = model_path;
+    return static_cast<udpipe_model_t>(h);
+}
+
+extern "C" udpipe_model_t udpipe_model_load_memory(const void* data, size_t size) {
+    if (!data || !size) return nullptr;
+    const int node = cpu_topology::current_node();
+    return static_cast<udpipe_model_t>(wrap_model(load_model_from_memory(data, size), node));
+}
+
+extern "C" void udpipe_model_retain(udpipe_model_t handle) {
+    if (!handle) return;
+    static_cast<ModelHandle*>(handle)->refs.fetch_add(1, std::memory_order_relaxed);
 }
 
 extern "C" void udpipe_model_free(udpipe_model_t handle) {
     if (!handle) return;
-    model* m = static_cast<model*>(handle);
-    delete m;
+    auto h = static_cast<ModelHandle*>(handle);
+    if (h->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete h;
+}
+
+extern "C" udpipe_registry_t udpipe_registry_create(size_t memory_budget) {
+    try {
+        return static_cast<udpipe_registry_t>(new ModelRegistry(memory_budget));
+    } catch (...) {
+        // std::thread reports resource exhaustion through std::system_error.
+        return nullptr;
+    }
+}
+
+extern "C" void udpipe_registry_free(udpipe_registry_t registry) {
+    if (!registry) return;
+    delete static_cast<ModelRegistry*>(registry);
+}
+
+extern "C" udpipe_model_t udpipe_registry_acquire(udpipe_registry_t registry, const char* model_path) {
+    if (!registry || !model_path) return nullptr;
+    return static_cast<ModelRegistry*>(registry)->acquire(model_path);
+}
+
+extern "C" int udpipe_registry_preload(udpipe_registry_t registry, const char* model_path) {
+    if (!registry || !model_path) return 0;
+    return static_cast<ModelRegistry*>(registry)->preload(model_path) ? 1 : 0;
+}
+
+extern "C" size_t udpipe_registry_memory_usage(udpipe_registry_t registry) {
+    if (!registry) return 0;
+    return static_cast<ModelRegistry*>(registry)->memory_usage();
+}
+
+extern "C" size_t udpipe_registry_size(udpipe_registry_t registry) {
+    if (!registry) return 0;
+    return static_cast<ModelRegistry*>(registry)->size();
+}
+
+extern "C" int udpipe_model_set_sentence_cache(udpipe_model_t handle, size_t capacity) {
+    if (!handle) return 0;
+    auto h = static_cast<ModelHandle*>(handle);
+    std::shared_ptr<SentenceCache> cache;
+    if (capacity) cache = std::make_shared<SentenceCache>(capacity);
+    std::atomic_store(&h->sentence_cache, std::move(cache));
+    return 1;
+}
+
+#ifdef UDPIPE_TESTING
+extern "C" int udpipe_model_fail_on_form(udpipe_model_t handle, const char* form) {
+    if (!handle) return 0;
+    auto h = static_cast<ModelHandle*>(handle);
+    std::shared_ptr<const std::string> failing;
+    if (form && *form) failing = std::make_shared<const std::string>(form);
+    h->fails_on_form = failing != nullptr;
+    std::atomic_store(&h->failing_form, std::move(failing));
+    return 1;
+}
+#endif
+
+extern "C" void udpipe_model_sentence_cache_stats(udpipe_model_t handle, udpipe_cache_stats* out_stats) {
+    if (!out_stats) return;
+    *out_stats = udpipe_cache_stats{};
+    if (!handle) return;
+    std::shared_ptr<SentenceCache> cache = std::atomic_load(&static_cast<ModelHandle*>(handle)->sentence_cache);
+    if (cache) cache->stats(out_stats);
+}
+
+extern "C" size_t udpipe_vocab_size(udpipe_model_t handle, int field) {
+    if (!handle || field < 0 || field >= UDPIPE_TAG_FIELD_COUNT) return 0;
+    return static_cast<ModelHandle*>(handle)->vocabulary.size(field);
+}
+
+extern "C" const char* udpipe_vocab_entry(udpipe_model_t handle, int field, size_t id) {
+    if (!handle || field < 0 || field >= UDPIPE_TAG_FIELD_COUNT) return nullptr;
+    return static_cast<ModelHandle*>(handle)->vocabulary.entry(field, id);
 }
 
 extern "C" char* udpipe_tag_conllu(udpipe_model_t handle, const char* utf8_text) {
     if (!handle || !utf8_text) return nullptr;
 
-    model* m = static_cast<model*>(handle);
+    model* m = static_cast<ModelHandle*>(handle)->get();
+    if (!m) return nullptr;
 
     // Set up a pipeline: input via tokenizer, tagging only, CoNLL-U output
     pipeline p(m, /*input*/ "tokenizer", /*tagger*/ model::DEFAULT, /*parser*/ pipeline::NONE, /*output*/ "conllu");
@@ -115,278 +433,1489 @@ extern "C" void udpipe_string_free(char* p) {
     std::free(p);
 }
 
-extern "C" int udpipe_tag_structured(udpipe_model_t handle, const char* utf8_text, int do_parse,
-                                      udpipe_doc_view* out_doc) {
-    if (!handle || !utf8_text || !out_doc) return 0;
-    out_doc->sentences = nullptr;
-    out_doc->count = 0;
-    out_doc->arena = nullptr;
+extern "C" void udpipe_free_doc(udpipe_doc_view* doc) {
+    if (!doc) return;
 
+    // The arena owns the strings as well as the sentence and token arrays.
+    if (doc->arena) {
+        delete static_cast<StringArena*>(doc->arena);
+    }
+
+    *doc = udpipe_doc_view{};
+}
+
+extern "C" void udpipe_doc_recycle(udpipe_doc_view* doc) {
+    if (!doc) return;
+    if (doc->arena) {
+        auto arena = static_cast<StringArena*>(doc->arena);
+        arena->recycle();
+        delete arena;
+    }
+    *doc = udpipe_doc_view{};
+}
+
+extern "C" void udpipe_arena_pool_get_stats(udpipe_arena_pool_stats* out_stats) {
+    if (!out_stats) return;
+    block_pool::stats(out_stats);
+}
+
+extern "C" void udpipe_arena_pool_trim(void) {
+    block_pool::trim();
+}
+
+// Stores `value` as an interned tag, falling back to an arena copy once the
+// field's vocabulary is full.
+static const char* intern_tag(TagInterner& tags, StringArena& arena, int field, const std::string& value,
+                              uint16_t& id) {
+    const char* str = nullptr;
+    id = tags.intern(field, value, &str);
+    return id != TagVocabulary::NO_ID ? str : arena.allocate(value);
+}
+
+// Applies the UDPIPE_WANT_* selection in `flags`: drops the stages no selected field
+// needs, and selects every field if none is. Idempotent.
+static unsigned resolve_fields(unsigned flags) {
+    if (!(flags & UDPIPE_WANT_ALL)) return flags | UDPIPE_WANT_ALL;
+    if (!(flags & UDPIPE_WANT_DEPS) && (flags & UDPIPE_STAGE_PARSE)) {
+        flags = (flags & ~static_cast<unsigned>(UDPIPE_STAGE_PARSE)) | UDPIPE_STAGE_TAG;
+    }
+    const unsigned tagger_fields = UDPIPE_WANT_LEMMA | UDPIPE_WANT_UPOS | UDPIPE_WANT_XPOS | UDPIPE_WANT_FEATS;
+    if (!(flags & tagger_fields) && !(flags & UDPIPE_STAGE_PARSE)) flags &= ~static_cast<unsigned>(UDPIPE_STAGE_TAG);
+    return flags;
+}
+
+// UDPipe only records token ranges when the tokenizer is asked to, and every
+// structured result carries offsets, so make sure `ranges` is among the options.
+static std::string tokenizer_options_with_ranges(const char* options) {
+    std::string opts = options ? options : "";
+    for (size_t pos = 0; pos <= opts.size();) {
+        size_t end = opts.find(';', pos);
+        if (end == std::string::npos) end = opts.size();
+        if (opts.compare(pos, end - pos, model::TOKENIZER_RANGES) == 0) return opts;
+        pos = end + 1;
+    }
+    if (!opts.empty()) opts += ';';
+    opts += model::TOKENIZER_RANGES;
+    return opts;
+}
+
+// Tokenizers kept idle per model for reuse; enough for every worker of a large pool.
+static constexpr size_t MAX_IDLE_READERS = 64;
+
+static bool is_default_tokenizer_options(const char* options) {
+    return !options || !*options;
+}
+
+// Returns a tokenizer with the default options, reusing an idle one if possible.
+// Building a tokenizer allocates the whole network state of the GRU tokenizer,
+// which dwarfs tokenizing a short text, so one-shot and batch calls recycle them.
+// The tokenizer comes from the copy of the model for NUMA node `node` (see
+// ModelHandle::for_node); `pool` receives where to check it back in.
+static std::unique_ptr<input_format> checkout_reader(ModelHandle* h, int node, ReaderPool*& pool) {
+    model* m = h->for_node(node, &pool);
+    if (!m) return nullptr;
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        if (!pool->idle.empty()) {
+            std::unique_ptr<input_format> reader = std::move(pool->idle.back());
+            pool->idle.pop_back();
+            return reader;
+        }
+    }
+    return std::unique_ptr<input_format>(m->new_tokenizer(tokenizer_options_with_ranges(nullptr)));
+}
+
+static void checkin_reader(ReaderPool* pool, std::unique_ptr<input_format> reader) {
+    if (!reader || !pool) return;
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    if (pool->idle.size() < MAX_IDLE_READERS) pool->idle.push_back(std::move(reader));
+}
+
+// Converts the code point offsets UDPipe stores in TokenRange into UTF-8 byte
+// offsets. Lookups within a document mostly move forward, so a cursor keeps the
+// conversion linear in the length of the text.
+class Utf8OffsetMap {
+    const char* text_;
+    size_t len_;
+    size_t chars_ = 0;
+    size_t bytes_ = 0;
+
+public:
+    Utf8OffsetMap(const char* text, size_t len) : text_(text), len_(len) {}
+
+    size_t to_bytes(size_t char_offset) {
+        if (char_offset < chars_) { chars_ = 0; bytes_ = 0; }
+        while (chars_ < char_offset && bytes_ < len_) {
+            ++bytes_;
+            while (bytes_ < len_ && (static_cast<unsigned char>(text_[bytes_]) & 0xC0) == 0x80) ++bytes_;
+            ++chars_;
+        }
+        return bytes_;
+    }
+};
+
+// The input range a word was read from, in bytes, and whether its form is a
+// verbatim copy of those bytes. Words of a multiword token (`mwt` non-NULL) have
+// no range of their own; they get the range of the surface token they were split from.
+struct WordSpan {
+    size_t start = 0;
+    size_t end = 0;
+    bool has_range = false;
+    bool verbatim = false;
+};
+
+static WordSpan word_span(const word& w, const multiword_token* mwt, Utf8OffsetMap& offsets, const char* text,
+                          size_t text_len) {
+    WordSpan span;
+    size_t start = 0, end = 0;
+    if ((mwt ? mwt->get_token_range(start, end) : w.get_token_range(start, end)) && start <= end) {
+        span.start = offsets.to_bytes(start);
+        span.end = offsets.to_bytes(end);
+        span.has_range = true;
+    }
+    span.verbatim = !mwt && span.end > span.start && span.end <= text_len &&
+                    w.form.size() == span.end - span.start &&
+                    std::memcmp(text + span.start, w.form.data(), w.form.size()) == 0;
+    return span;
+}
+
+// Copies `toks` and the sentence views (ranges into `toks`) into `arena` and
+// publishes them in `doc`, leaving both vectors empty. Returns false on
+// allocation failure.
+static bool publish_tokens(StringArena& arena, std::vector<udpipe_token>& toks,
+                           std::vector<udpipe_sentence_view>& sentences, udpipe_doc_view* doc) {
+    udpipe_token* tokens = nullptr;
+    udpipe_sentence_view* views = nullptr;
+    if (!toks.empty()) {
+        tokens = static_cast<udpipe_token*>(arena.allocate_bytes(sizeof(udpipe_token) * toks.size(),
+                                                                 alignof(udpipe_token)));
+        if (!tokens) return false;
+        std::memcpy(tokens, toks.data(), sizeof(udpipe_token) * toks.size());
+    }
+    if (!sentences.empty()) {
+        views = static_cast<udpipe_sentence_view*>(arena.allocate_bytes(
+            sizeof(udpipe_sentence_view) * sentences.size(), alignof(udpipe_sentence_view)));
+        if (!views) return false;
+        for (size_t i = 0; i < sentences.size(); ++i) {
+            views[i] = sentences[i];
+            views[i].tokens = tokens ? tokens + sentences[i].offset : nullptr;
+        }
+    }
+    doc->tokens = tokens;
+    doc->token_count = toks.size();
+    doc->sentences = views;
+    doc->count = sentences.size();
+    toks.clear();
+    sentences.clear();
+    return true;
+}
+
+// Records in `doc` that `skipped` sentences were dropped or that processing stopped
+// early with `error` (UDPIPE_SKIP_BAD_SENTENCES); the error is copied into `arena`.
+static void set_partial_outcome(StringArena& arena, size_t skipped, const std::string& error,
+                                udpipe_doc_view* doc) {
+    doc->skipped_sentences = skipped;
+    if (skipped == 0 && error.empty()) return;
+    doc->status = UDPIPE_DOC_PARTIAL;
+    doc->error = arena.allocate(error);
+}
+
+// The error to report for the exception being handled; call from a catch block.
+static std::string exception_message() {
+    try {
+        throw;
+    } catch (const std::bad_alloc&) {
+        return "out of memory";
+    } catch (const std::exception& e) {
+        return e.what();
+    } catch (...) {
+        return "processing failed";
+    }
+}
+
+// Empties `doc` and marks it UDPIPE_DOC_FAILED, keeping `error` in a fresh arena.
+static void set_failed_outcome(const std::string& error, udpipe_doc_view* doc) {
+    udpipe_free_doc(doc);
     auto arena = new StringArena();
-    out_doc->arena = arena;
+    doc->arena = arena;
+    doc->status = UDPIPE_DOC_FAILED;
+    doc->error = arena->allocate(error.empty() ? "processing failed" : error);
+}
 
-    model* m = static_cast<model*>(handle);
+// Marshals the sentences of one document into udpipe tokens. Tokens accumulate
+// in caller-owned scratch vectors (a session reuses them across documents);
+// sentences are ranges into them until `publish` copies everything into the
+// arena as one flat token array. With UDPIPE_OUTPUT_COLUMNS, forms and lemmas
+// are packed into string buffers instead of being copied one by one, and
+// `publish` transposes the tokens into udpipe_columns. After `encode_to`,
+// tokens are written to a binary_format::Encoder instead and nothing is kept.
+class DocumentBuilder {
+    StringArena& arena_;
+    TagInterner& tags_;
+    const char* text_;
+    size_t text_len_;
+    Utf8OffsetMap offsets_;
+    unsigned flags_;
+    size_t base_offset_;
+    std::vector<udpipe_token>& toks_;
+    std::vector<udpipe_sentence_view>& sentences_;
+    // Packed forms and lemmas, and where each token's ends (columnar output only).
+    std::string forms_;
+    std::string lemmas_;
+    std::vector<size_t> form_ends_;
+    std::vector<size_t> lemma_ends_;
+    binary_format::Encoder* encoder_ = nullptr;
 
-    // Set up tokenizer input; we'll manually step sentences to access structures.
-    std::unique_ptr<input_format> reader(m->new_tokenizer(""));
-    if (!reader) return 0;
-    reader->reset_document("");
-    reader->set_text(utf8_text);
+    template <class T>
+    T* allocate_array(size_t count) {
+        return static_cast<T*>(arena_.allocate_bytes(sizeof(T) * std::max<size_t>(count, 1), alignof(T)));
+    }
 
-    std::vector<udpipe_sentence_view> sentences;
-    sentence s;
-    std::string error;
-    while (reader->next_sentence(s, error)) {
-        if (!error.empty()) { break; }
-        // Run tagger and optionally parser
-        if (!m->tag(s, model::DEFAULT, error)) { break; }
-        if (do_parse) {
-            if (!m->parse(s, model::DEFAULT, error)) { break; }
+    // Copies the packed strings in `chars` into the arena and fills `offsets` from
+    // `ends`. Returns false on allocation failure or if an offset exceeds 32 bits.
+    bool publish_strings(const std::string& chars, const std::vector<size_t>& ends, const char** out_chars,
+                         const uint32_t** out_offsets) {
+        if (chars.size() > UINT32_MAX) return false;
+        char* packed = allocate_array<char>(chars.size());
+        uint32_t* offsets = allocate_array<uint32_t>(ends.size() + 1);
+        if (!packed || !offsets) return false;
+        std::memcpy(packed, chars.data(), chars.size());
+        offsets[0] = 0;
+        for (size_t i = 0; i < ends.size(); ++i) offsets[i + 1] = static_cast<uint32_t>(ends[i]);
+        *out_chars = packed;
+        *out_offsets = offsets;
+        return true;
+    }
+
+    bool publish_columns(udpipe_doc_view* doc) {
+        const size_t n = toks_.size();
+        if (base_offset_ + text_len_ > UINT32_MAX) return false;
+        auto columns = allocate_array<udpipe_columns>(1);
+        auto ids = allocate_array<int32_t>(n);
+        auto heads = allocate_array<int32_t>(n);
+        auto upos = allocate_array<uint16_t>(n);
+        auto xpostag = allocate_array<uint16_t>(n);
+        auto feats = allocate_array<uint16_t>(n);
+        auto deprel = allocate_array<uint16_t>(n);
+        auto starts = allocate_array<uint32_t>(n);
+        auto ends = allocate_array<uint32_t>(n);
+        auto token_flags = allocate_array<uint16_t>(n);
+        auto sentence_offsets = allocate_array<uint32_t>(sentences_.size() + 1);
+        if (!columns || !ids || !heads || !upos || !xpostag || !feats || !deprel || !starts || !ends ||
+            !token_flags || !sentence_offsets) {
+            return false;
         }
+        *columns = udpipe_columns{};
+        if (!publish_strings(forms_, form_ends_, &columns->forms, &columns->form_offsets) ||
+            !publish_strings(lemmas_, lemma_ends_, &columns->lemmas, &columns->lemma_offsets)) {
+            return false;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            const udpipe_token& t = toks_[i];
+            ids[i] = t.id;
+            heads[i] = t.head;
+            upos[i] = t.upos_id;
+            xpostag[i] = t.xpostag_id;
+            feats[i] = t.feats_id;
+            deprel[i] = t.deprel_id;
+            starts[i] = static_cast<uint32_t>(t.start);
+            ends[i] = static_cast<uint32_t>(t.end);
+            token_flags[i] = t.flags;
+        }
+        sentence_offsets[0] = 0;
+        for (size_t j = 0; j < sentences_.size(); ++j) {
+            sentence_offsets[j + 1] = static_cast<uint32_t>(sentences_[j].offset + sentences_[j].count);
+        }
+        columns->ids = ids;
+        columns->heads = heads;
+        columns->upos_ids = upos;
+        columns->xpostag_ids = xpostag;
+        columns->feats_ids = feats;
+        columns->deprel_ids = deprel;
+        columns->starts = starts;
+        columns->ends = ends;
+        columns->flags = token_flags;
+        columns->sentence_offsets = sentence_offsets;
+
+        doc->columns = columns;
+        doc->token_count = n;
+        doc->count = sentences_.size();
+        toks_.clear();
+        sentences_.clear();
+        forms_.clear();
+        lemmas_.clear();
+        form_ends_.clear();
+        lemma_ends_.clear();
+        return true;
+    }
+
+    // Interns `value` if `wanted`; otherwise leaves the field empty, which is id 0 of
+    // every vocabulary.
+    const char* tag_field(bool wanted, int field, const std::string& value, uint16_t& id) {
+        if (!wanted) {
+            id = 0;
+            return "";
+        }
+        return intern_tag(tags_, arena_, field, value, id);
+    }
+
+public:
+    // `base_offset` is added to every token offset; it positions `text` within a
+    // longer input that is processed piece by piece.
+    DocumentBuilder(StringArena& arena, TagInterner& tags, const char* text, size_t text_len, unsigned flags,
+                    std::vector<udpipe_token>& toks, std::vector<udpipe_sentence_view>& sentences,
+                    size_t base_offset = 0)
+        : arena_(arena), tags_(tags), text_(text), text_len_(text_len), offsets_(text, text_len),
+          flags_(resolve_fields(flags)), base_offset_(base_offset), toks_(toks), sentences_(sentences) {
+        toks_.clear();
+        sentences_.clear();
+    }
 
-        std::vector<udpipe_token> toks;
-        toks.reserve(s.words.size());
+    void encode_to(binary_format::Encoder* encoder) { encoder_ = encoder; }
+
+    // Appends the word tokens of `s`, copying forms and lemmas into the arena and
+    // interning the tag fields. Without UDPIPE_STAGE_TAG only forms and offsets
+    // are filled in, and fields left out by UDPIPE_WANT_* stay empty.
+    void add_sentence(const sentence& s) {
+        UDPIPE_STATS_SCOPE(UDPIPE_STAT_MARSHAL);
+        static const std::string empty;
+        const bool tagged = (flags_ & (UDPIPE_STAGE_TAG | UDPIPE_STAGE_PARSE)) != 0;
+        const unsigned fields = tagged ? flags_ & UDPIPE_WANT_ALL : 0;
+        const bool lemma = (fields & UDPIPE_WANT_LEMMA) != 0;
+        const bool deps = (fields & UDPIPE_WANT_DEPS) != 0;
+        const bool borrow = (flags_ & UDPIPE_BORROW_FORMS) != 0;
+        const bool columns = (flags_ & UDPIPE_OUTPUT_COLUMNS) != 0;
+
+        udpipe_sentence_view view{};
+        view.offset = toks_.size();
+        if (encoder_) {
+            size_t words = 0;
+            for (const auto& w : s.words) words += w.id > 0;
+            encoder_->begin_sentence(words);
+        }
+
+        auto mwt = s.multiword_tokens.begin();
         for (const auto& w : s.words) {
             if (w.id <= 0) continue; // skip non-words
+            while (mwt != s.multiword_tokens.end() && mwt->id_last < w.id) ++mwt;
+            const bool in_mwt = mwt != s.multiword_tokens.end() && mwt->id_first <= w.id;
+
             udpipe_token t{};
             t.id = w.id;
-            t.head = w.head;
-            t.form = arena->allocate(w.form);
-            t.lemma = arena->allocate(w.lemma);
-            t.upos = arena->allocate(w.upostag);
-            t.xpostag = arena->allocate(w.xpostag);
-            t.feats = arena->allocate(w.feats);
-            t.deprel = arena->allocate(w.deprel);
-            size_t start = 0, end = 0;
-            if (w.get_token_range(start, end)) { t.start = start; t.end = end; }
-            else { t.start = 0; t.end = 0; }
-            toks.push_back(t);
+            const WordSpan span = word_span(w, in_mwt ? &*mwt : nullptr, offsets_, text_, text_len_);
+            t.start = span.has_range ? base_offset_ + span.start : 0;
+            t.end = span.has_range ? base_offset_ + span.end : 0;
+
+            const bool verbatim = span.verbatim;
+            if (!verbatim) t.flags |= UDPIPE_TOKEN_FORM_DIFFERS;
+            t.head = deps ? w.head : -1;
+            if (encoder_) {
+                const std::string* tags[UDPIPE_TAG_FIELD_COUNT] = {&empty, &empty, &empty, &empty};
+                if (fields & UDPIPE_WANT_UPOS) tags[UDPIPE_FIELD_UPOS] = &w.upostag;
+                if (fields & UDPIPE_WANT_XPOS) tags[UDPIPE_FIELD_XPOS] = &w.xpostag;
+                if (fields & UDPIPE_WANT_FEATS) tags[UDPIPE_FIELD_FEATS] = &w.feats;
+                if (deps) tags[UDPIPE_FIELD_DEPREL] = &w.deprel;
+                encoder_->add_token(t, w.form, lemma ? w.lemma : empty, tags);
+                continue;
+            }
+            if (columns) {
+                forms_ += w.form;
+                form_ends_.push_back(forms_.size());
+                if (lemma) lemmas_ += w.lemma;
+                lemma_ends_.push_back(lemmas_.size());
+            } else {
+                t.form = borrow && verbatim ? nullptr : arena_.allocate(w.form);
+                t.lemma = lemma ? arena_.allocate(w.lemma) : "";
+            }
+            t.upos = tag_field(fields & UDPIPE_WANT_UPOS, UDPIPE_FIELD_UPOS, w.upostag, t.upos_id);
+            t.xpostag = tag_field(fields & UDPIPE_WANT_XPOS, UDPIPE_FIELD_XPOS, w.xpostag, t.xpostag_id);
+            t.feats = tag_field(fields & UDPIPE_WANT_FEATS, UDPIPE_FIELD_FEATS, w.feats, t.feats_id);
+            t.deprel = tag_field(deps, UDPIPE_FIELD_DEPREL, w.deprel, t.deprel_id);
+            toks_.push_back(t);
         }
-        // Allocate C array for tokens
-        udpipe_sentence_view view{};
-        view.count = toks.size();
-        view.tokens = (udpipe_token*)std::malloc(sizeof(udpipe_token) * view.count);
-        if (!view.tokens) { error = "alloc failure"; break; }
-        std::memcpy(view.tokens, toks.data(), sizeof(udpipe_token) * view.count);
-        sentences.push_back(view);
 
-        s.clear();
+        if (encoder_) return;
+        view.count = toks_.size() - view.offset;
+        sentences_.push_back(view);
+        UDPIPE_STATS_COUNT(1, view.count);
     }
 
-    if (!error.empty()) {
-        // free partial allocations
-        udpipe_doc_view tmp{sentences.data(), sentences.size()};
-        udpipe_free_doc(&tmp);
-        return 0;
+    // Copies the gathered tokens and sentence views into the arena and publishes
+    // them in `doc`. Returns false on allocation failure.
+    bool publish(udpipe_doc_view* doc) {
+        UDPIPE_STATS_SCOPE(UDPIPE_STAT_MARSHAL);
+        if (flags_ & UDPIPE_OUTPUT_COLUMNS) return publish_columns(doc);
+        return publish_tokens(arena_, toks_, sentences_, doc);
     }
+};
 
-    // Allocate sentences array to return
-    out_doc->count = sentences.size();
-    out_doc->sentences = (udpipe_sentence_view*)std::malloc(sizeof(udpipe_sentence_view) * out_doc->count);
-    if (!out_doc->sentences) {
-        out_doc->count = 0; return 0;
+// Reads the next sentence from `reader`; input_format::next_sentence, timed as
+// the tokenization stage.
+static bool read_sentence(input_format& reader, sentence& s, std::string& error) {
+    UDPIPE_STATS_SCOPE(UDPIPE_STAT_TOKENIZE);
+    return reader.next_sentence(s, error);
+}
+
+// Sentences that go through the tagger and parser together (see run_stages).
+static constexpr size_t STAGE_GROUP_SENTENCES = 8;
+
+// Runs the requested stages over a group of sentences one stage at a time: the
+// tagger over every sentence, then the parser over every sentence. Alternating
+// the two per sentence makes each evict the other's weights and feature caches;
+// going stage by stage keeps one component's working set hot across the group.
+// Results are identical to processing the sentences one by one.
+static bool run_model_stages(model* m, sentence* const* group, size_t count, bool do_tag, bool do_parse,
+                             std::string& error) {
+    if (do_tag) {
+        for (size_t i = 0; i < count; ++i) {
+            UDPIPE_STATS_SCOPE(UDPIPE_STAT_TAG);
+            if (!m->tag(*group[i], model::DEFAULT, error)) return false;
+        }
     }
-    std::memcpy(out_doc->sentences, sentences.data(), sizeof(udpipe_sentence_view) * out_doc->count);
-    return 1;
+    if (do_parse) {
+        for (size_t i = 0; i < count; ++i) {
+            UDPIPE_STATS_SCOPE(UDPIPE_STAT_PARSE);
+            if (!m->parse(*group[i], model::DEFAULT, error)) return false;
+        }
+    }
+    return true;
 }
 
-extern "C" void udpipe_free_doc(udpipe_doc_view* doc) {
-    if (!doc) return;
+#ifdef UDPIPE_TESTING
+// Returns false with `error` set if a sentence of the group contains the form set with
+// udpipe_model_fail_on_form.
+static bool check_failing_form(ModelHandle* h, sentence* const* group, size_t count, std::string& error) {
+    std::shared_ptr<const std::string> form = std::atomic_load(&h->failing_form);
+    if (!form) return true;
+    for (size_t i = 0; i < count; ++i) {
+        for (const auto& w : group[i]->words) {
+            if (w.form == *form) return error.assign("injected failure"), false;
+        }
+    }
+    return true;
+}
+#endif
 
-    // The arena owns all the string data. Freeing the arena frees the strings.
-    if (doc->arena) {
-        delete static_cast<StringArena*>(doc->arena);
+// As run_model_stages, but sentences found in the model's sentence cache (if
+// it has one) are annotated from it, and the rest are added to it.
+static bool run_stages(ModelHandle* h, model* m, sentence* const* group, size_t count, bool do_tag, bool do_parse,
+                       std::string& error) {
+#ifdef UDPIPE_TESTING
+    if (h->fails_on_form && !check_failing_form(h, group, count, error)) return false;
+#endif
+    std::shared_ptr<SentenceCache> cache = do_tag ? std::atomic_load(&h->sentence_cache) : nullptr;
+    if (!cache) return run_model_stages(m, group, count, do_tag, do_parse, error);
+
+    const unsigned stages = do_parse ? UDPIPE_STAGE_PARSE : UDPIPE_STAGE_TAG;
+    std::vector<sentence*> misses;
+    std::vector<std::string> keys;
+    misses.reserve(count);
+    keys.reserve(count);
+    std::string key;
+    for (size_t i = 0; i < count; ++i) {
+        if (cache->lookup(stages, *group[i], key)) continue;
+        misses.push_back(group[i]);
+        keys.push_back(std::move(key));
+    }
+    if (!run_model_stages(m, misses.data(), misses.size(), do_tag, do_parse, error)) return false;
+    for (size_t i = 0; i < misses.size(); ++i) {
+        cache->insert(std::move(keys[i]), *misses[i]);
+    }
+    return true;
+}
+
+// run_stages for UDPIPE_SKIP_BAD_SENTENCES: if the group fails, its sentences are
+// retried one at a time and those that fail again are cleared, for the caller to
+// leave out. `error` receives the first failure. Returns the number of sentences cleared.
+static size_t run_stages_skipping(ModelHandle* h, model* m, sentence* const* group, size_t count, bool do_tag,
+                                  bool do_parse, std::string& error) {
+    std::string group_error;
+    if (run_stages(h, m, group, count, do_tag, do_parse, group_error)) return 0;
+    size_t skipped = 0;
+    for (size_t i = 0; i < count; ++i) {
+        std::string sentence_error;
+        if (run_stages(h, m, group + i, 1, do_tag, do_parse, sentence_error)) continue;
+        if (error.empty()) error = sentence_error.empty() ? group_error : sentence_error;
+        group[i]->clear();
+        ++skipped;
+    }
+    return skipped;
+}
+
+// Turns text into a udpipe_doc_view. Keeps the tokenizer, the working sentence and
+// the marshalling buffers between calls, so a long-lived instance (a session) pays
+// for tokenizer construction and buffer growth only once.
+class DocumentProcessor {
+    ModelHandle* h_;
+    model* m_;
+    TagInterner tags_;
+    bool pooled_reader_;
+    std::string tokenizer_options_;
+    std::unique_ptr<input_format> reader_;
+    ReaderPool* reader_pool_ = nullptr; // where a pooled `reader_` goes back to
+    std::vector<sentence> group_;
+    std::vector<sentence*> group_ptrs_;
+    std::vector<udpipe_token> toks_;
+    std::vector<udpipe_sentence_view> sentences_;
+    // Outcome of the last `run` under UDPIPE_SKIP_BAD_SENTENCES.
+    size_t skipped_ = 0;
+    std::string skip_error_;
+
+public:
+    DocumentProcessor(ModelHandle* h, const char* tokenizer_options)
+        : h_(h), m_(h->get()), tags_(h->vocabulary), pooled_reader_(is_default_tokenizer_options(tokenizer_options)),
+          tokenizer_options_(tokenizer_options_with_ranges(tokenizer_options)), group_(STAGE_GROUP_SENTENCES) {
+        for (auto& s : group_) group_ptrs_.push_back(&s);
+    }
+
+    ~DocumentProcessor() {
+        if (pooled_reader_) checkin_reader(reader_pool_, std::move(reader_));
+    }
+
+    DocumentProcessor(const DocumentProcessor&) = delete;
+    DocumentProcessor& operator=(const DocumentProcessor&) = delete;
+
+    // Creates the tokenizer on first use. Returns false if the model has none.
+    bool prepare() {
+        if (!m_) return false;
+        if (!reader_) {
+            if (pooled_reader_) reader_ = checkout_reader(h_, -1, reader_pool_);
+            else reader_.reset(m_->new_tokenizer(tokenizer_options_));
+        }
+        return reader_ != nullptr;
     }
 
-    // The doc owns the sentence_view array, and each sentence_view owns its token array.
-    if (doc->sentences) {
-        for (size_t i = 0; i < doc->count; ++i) {
-            udpipe_sentence_view& sv = doc->sentences[i];
-            if (sv.tokens) {
-                std::free(sv.tokens);
+    // Processes `text_len` bytes of `utf8_text` according to the UDPIPE_* bits in
+    // `flags`. Returns 1 on success, 0 on failure (leaving `out_doc` empty).
+    int process(const char* utf8_text, size_t text_len, unsigned flags, udpipe_doc_view* out_doc) {
+        *out_doc = udpipe_doc_view{};
+        flags = resolve_fields(flags);
+        if (!prepare()) return 0;
+
+        auto arena = new StringArena();
+        out_doc->arena = arena;
+
+        DocumentBuilder builder(*arena, tags_, utf8_text, text_len, flags, toks_, sentences_);
+        if (run(utf8_text, text_len, flags, builder) && builder.publish(out_doc)) {
+            set_partial_outcome(*arena, skipped_, skip_error_, out_doc);
+            return 1;
+        }
+
+        // free partial allocations, including the arena
+        udpipe_free_doc(out_doc);
+        return 0;
+    }
+
+    // Processes the text like `process`, but serialises it in the binary format
+    // (see binary_format.h) into a malloc'd buffer. Returns NULL on failure.
+    char* encode(const char* utf8_text, size_t text_len, unsigned flags, size_t* out_len) {
+        if (!prepare()) return nullptr;
+        flags = resolve_fields(flags & ~static_cast<unsigned>(UDPIPE_BORROW_FORMS | UDPIPE_OUTPUT_COLUMNS));
+        binary_format::Encoder encoder(flags & (UDPIPE_STAGE_TAG | UDPIPE_STAGE_PARSE));
+        StringArena unused;
+        DocumentBuilder builder(unused, tags_, utf8_text, text_len, flags, toks_, sentences_);
+        builder.encode_to(&encoder);
+        if (!run(utf8_text, text_len, flags, builder)) return nullptr;
+        return encoder.finish(out_len);
+    }
+
+private:
+    // Tokenizes the text and runs the requested stages, handing every sentence to
+    // `builder`. Returns false on failure.
+    bool run(const char* utf8_text, size_t text_len, unsigned flags, DocumentBuilder& builder) {
+        reader_->reset_document("");
+        reader_->set_text(string_piece(utf8_text, text_len));
+
+        const bool do_tag = (flags & (UDPIPE_STAGE_TAG | UDPIPE_STAGE_PARSE)) != 0;
+        const bool do_parse = (flags & UDPIPE_STAGE_PARSE) != 0;
+        const bool skip = (flags & UDPIPE_SKIP_BAD_SENTENCES) != 0;
+        skipped_ = 0;
+        skip_error_.clear();
+
+        std::string error;
+        for (bool more = true; more && error.empty();) {
+            size_t n = 0;
+            while (n < group_.size() && (more = read_sentence(*reader_, group_[n], error)) && error.empty()) ++n;
+            // Run tagger and optionally parser; with `skip`, a tokenizer error still
+            // keeps the sentences read before it.
+            if (!error.empty() && !skip) break;
+            if (skip) {
+                skipped_ += run_stages_skipping(h_, m_, group_ptrs_.data(), n, do_tag, do_parse, skip_error_);
+            } else if (!run_stages(h_, m_, group_ptrs_.data(), n, do_tag, do_parse, error)) {
+                break;
             }
+
+            for (size_t i = 0; i < n; ++i) {
+                if (!group_[i].empty()) builder.add_sentence(group_[i]);
+                group_[i].clear();
+            }
+        }
+        for (auto& s : group_) s.clear();
+        if (skip && !error.empty()) {
+            if (skip_error_.empty()) skip_error_ = std::move(error);
+            return true;
         }
-        std::free(doc->sentences);
+        return error.empty();
     }
+};
 
-    doc->sentences = nullptr;
-    doc->count = 0;
-    doc->arena = nullptr;
+extern "C" int udpipe_tag_structured(udpipe_model_t handle, const char* utf8_text, int do_parse,
+                                      udpipe_doc_view* out_doc) {
+    if (!handle || !utf8_text || !out_doc) return 0;
+    DocumentProcessor processor(static_cast<ModelHandle*>(handle), nullptr);
+    return processor.process(utf8_text, std::strlen(utf8_text), UDPIPE_STAGE_TAG | (do_parse ? UDPIPE_STAGE_PARSE : 0),
+                             out_doc);
+}
+
+extern "C" int udpipe_tag_structured_ex(udpipe_model_t handle, const char* utf8_text, size_t text_len,
+                                         unsigned int flags, udpipe_doc_view* out_doc) {
+    if (!handle || (!utf8_text && text_len) || !out_doc) return 0;
+    DocumentProcessor processor(static_cast<ModelHandle*>(handle), nullptr);
+    return processor.process(utf8_text ? utf8_text : "", text_len, flags, out_doc);
 }
 
 extern "C" int udpipe_tokenize_structured(udpipe_model_t handle, const char* utf8_text,
                                           const char* tokenizer_options,
                                           udpipe_doc_view* out_doc) {
     if (!handle || !utf8_text || !out_doc) return 0;
-    out_doc->sentences = nullptr;
-    out_doc->count = 0;
-    out_doc->arena = nullptr;
+    DocumentProcessor processor(static_cast<ModelHandle*>(handle), tokenizer_options);
+    return processor.process(utf8_text, std::strlen(utf8_text), 0, out_doc);
+}
 
-    auto arena = new StringArena();
-    out_doc->arena = arena;
+// Hands out tokenizers with the options of one `udpipe_tokenize_batch` call to its
+// tasks, built from the copy of the model for the calling worker's NUMA node (see
+// ModelHandle::for_node). Default options use that copy's idle tokenizers (see
+// checkout_reader); others are kept here, per copy, for the duration of the call.
+class TokenizerCheckout {
+    ModelHandle* h_;
+    bool pooled_;
+    std::string options_;
+    // Tokenizers with `options_`, for each replica by node id and then for the primary copy.
+    ReaderPool custom_[MAX_REPLICA_NODES + 1];
 
-    model* m = static_cast<model*>(handle);
-    const char* opts = tokenizer_options ? tokenizer_options : "";
+public:
+    TokenizerCheckout(ModelHandle* h, const char* tokenizer_options)
+        : h_(h), pooled_(is_default_tokenizer_options(tokenizer_options)),
+          options_(tokenizer_options_with_ranges(tokenizer_options)) {}
 
-    std::unique_ptr<input_format> reader(m->new_tokenizer(opts));
-    if (!reader) return 0;
-    reader->reset_document("");
-    reader->set_text(utf8_text);
+    // `pool` receives what to pass back to `checkin`.
+    std::unique_ptr<input_format> checkout(ReaderPool*& pool) {
+        const int node = WorkerPool::current_node();
+        if (pooled_) return checkout_reader(h_, node, pool);
+        ReaderPool* shared = nullptr;
+        model* m = h_->for_node(node, &shared);
+        pool = &custom_[shared == &h_->readers ? MAX_REPLICA_NODES : static_cast<size_t>(shared - h_->replica_readers)];
+        if (!m) return nullptr;
+        {
+            std::lock_guard<std::mutex> lock(pool->mutex);
+            if (!pool->idle.empty()) {
+                auto reader = std::move(pool->idle.back());
+                pool->idle.pop_back();
+                return reader;
+            }
+        }
+        return std::unique_ptr<input_format>(m->new_tokenizer(options_));
+    }
 
-    std::vector<udpipe_sentence_view> sentences;
-    sentence s;
-    std::string error;
-    while (reader->next_sentence(s, error)) {
-        if (!error.empty()) { break; }
+    void checkin(ReaderPool* pool, std::unique_ptr<input_format> reader) {
+        if (!reader || !pool) return;
+        if (pooled_) {
+            checkin_reader(pool, std::move(reader));
+            return;
+        }
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->idle.push_back(std::move(reader));
+    }
+};
+
+// Tokenizes `text_len` bytes of `text` into `doc`, copying forms into the document's
+// arena unless `borrow` lets verbatim ones point into `text`. Returns false with
+// `error` set on failure.
+static bool tokenize_to_token_doc(input_format& reader, const char* text, size_t text_len, bool borrow,
+                                  udpipe_token_doc* doc, std::string& error) {
+    reader.reset_document("");
+    reader.set_text(string_piece(text, text_len));
+    auto arena = new StringArena();
+    doc->arena = arena;
 
-        std::vector<udpipe_token> toks;
-        toks.reserve(s.words.size());
+    Utf8OffsetMap offsets(text, text_len);
+    std::vector<udpipe_plain_token> toks;
+    std::vector<size_t> sentence_offsets(1, 0);
+    sentence s;
+    while (read_sentence(reader, s, error)) {
+        if (!error.empty()) break;
+        UDPIPE_STATS_SCOPE(UDPIPE_STAT_MARSHAL);
+        auto mwt = s.multiword_tokens.begin();
         for (const auto& w : s.words) {
             if (w.id <= 0) continue; // skip non-words
-            udpipe_token t{};
-            t.id = w.id;
-            t.head = -1;
-            t.form = arena->allocate(w.form);
-            t.lemma = arena->allocate_empty();
-            t.upos = arena->allocate_empty();
-            t.xpostag = arena->allocate_empty();
-            t.feats = arena->allocate_empty();
-            t.deprel = arena->allocate_empty();
-            size_t start = 0, end = 0;
-            if (w.get_token_range(start, end)) { t.start = start; t.end = end; }
-            else { t.start = 0; t.end = 0; }
+            while (mwt != s.multiword_tokens.end() && mwt->id_last < w.id) ++mwt;
+            const bool in_mwt = mwt != s.multiword_tokens.end() && mwt->id_first <= w.id;
+
+            const WordSpan span = word_span(w, in_mwt ? &*mwt : nullptr, offsets, text, text_len);
+            udpipe_plain_token t{};
+            t.start = span.start;
+            t.end = span.end;
+            if (!span.verbatim) t.flags |= UDPIPE_TOKEN_FORM_DIFFERS;
+            t.form = borrow && span.verbatim ? nullptr : arena->allocate(w.form);
             toks.push_back(t);
         }
-        udpipe_sentence_view view{};
-        view.count = toks.size();
-        view.tokens = (udpipe_token*)std::malloc(sizeof(udpipe_token) * view.count);
-        if (!view.tokens) { error = "alloc failure"; break; }
-        std::memcpy(view.tokens, toks.data(), sizeof(udpipe_token) * view.count);
-        sentences.push_back(view);
+        UDPIPE_STATS_COUNT(1, toks.size() - sentence_offsets.back());
+        sentence_offsets.push_back(toks.size());
+    }
+    if (!error.empty()) return false;
 
-        s.clear();
+    auto tokens = static_cast<udpipe_plain_token*>(
+        arena->allocate_bytes(sizeof(udpipe_plain_token) * std::max<size_t>(toks.size(), 1),
+                              alignof(udpipe_plain_token)));
+    auto sentences = static_cast<size_t*>(
+        arena->allocate_bytes(sizeof(size_t) * sentence_offsets.size(), alignof(size_t)));
+    if (!tokens || !sentences) {
+        error = "out of memory";
+        return false;
     }
+    if (!toks.empty()) std::memcpy(tokens, toks.data(), sizeof(udpipe_plain_token) * toks.size());
+    std::memcpy(sentences, sentence_offsets.data(), sizeof(size_t) * sentence_offsets.size());
+    doc->tokens = tokens;
+    doc->token_count = toks.size();
+    doc->sentence_offsets = sentences;
+    doc->count = sentence_offsets.size() - 1;
+    return true;
+}
 
-    if (!error.empty()) {
-        udpipe_doc_view tmp{sentences.data(), sentences.size()};
-        udpipe_free_doc(&tmp);
-        return 0;
+static void release_token_doc(udpipe_token_doc* doc, bool reuse) {
+    if (doc->arena) {
+        auto arena = static_cast<StringArena*>(doc->arena);
+        if (reuse) arena->recycle();
+        delete arena;
     }
+    *doc = udpipe_token_doc{};
+}
 
-    out_doc->count = sentences.size();
-    out_doc->sentences = (udpipe_sentence_view*)std::malloc(sizeof(udpipe_sentence_view) * out_doc->count);
-    if (!out_doc->sentences) { out_doc->count = 0; return 0; }
-    std::memcpy(out_doc->sentences, sentences.data(), sizeof(udpipe_sentence_view) * out_doc->count);
-    return 1;
+// Empties `doc` and marks it UDPIPE_DOC_FAILED, keeping `error` in a fresh arena.
+static void set_failed_outcome(const std::string& error, udpipe_token_doc* doc) {
+    release_token_doc(doc, false);
+    auto arena = new StringArena();
+    doc->arena = arena;
+    doc->status = UDPIPE_DOC_FAILED;
+    doc->error = arena->allocate(error.empty() ? "tokenization failed" : error);
 }
 
-extern "C" int udpipe_tag_batch(udpipe_model_t handle, const char** utf8_texts, size_t batch_size, int do_parse,
-                                 udpipe_doc_view** out_docs, size_t* out_size) {
+extern "C" int udpipe_tokenize_batch(udpipe_model_t handle, udpipe_pool_t pool, const char** utf8_texts,
+                                     const size_t* text_lens, size_t batch_size, const char* tokenizer_options,
+                                     unsigned int flags, udpipe_token_doc** out_docs, size_t* out_size) {
     if (!handle || !utf8_texts || !out_docs || !out_size) return 0;
     *out_docs = nullptr;
     *out_size = 0;
 
-    model* m = static_cast<model*>(handle);
+    auto h = static_cast<ModelHandle*>(handle);
+    model* m = h->get();
+    if (!m) return 0;
+    WorkerPool& p = pool ? *static_cast<WorkerPool*>(pool) : WorkerPool::shared();
+    const bool borrow = (flags & UDPIPE_BORROW_FORMS) != 0;
+    const bool partial = (flags & UDPIPE_PARTIAL_BATCH) != 0;
+
+    auto docs = static_cast<udpipe_token_doc*>(std::malloc(sizeof(udpipe_token_doc) * std::max<size_t>(batch_size, 1)));
+    if (!docs) return 0;
+    for (size_t i = 0; i < batch_size; ++i) docs[i] = udpipe_token_doc{};
 
-    std::vector<udpipe_doc_view> results(batch_size);
-    std::atomic<size_t> next_index(0);
     std::atomic<bool> success_flag(true);
+    TokenizerCheckout readers(h, tokenizer_options);
+    WorkerPool::TaskGroup group;
+    // Without UDPIPE_PARTIAL_BATCH the first failure stops the batch, as in udpipe_tag_batch.
+    auto fail = [&](size_t i, const std::string& error) {
+        if (partial) set_failed_outcome(error, &docs[i]);
+        else success_flag = false;
+    };
 
-    unsigned int num_threads = std::thread::hardware_concurrency();
-    if (num_threads == 0) num_threads = 1;
-    if (num_threads > batch_size) num_threads = (unsigned int)batch_size;
-
-    std::vector<std::thread> threads;
-    threads.reserve(num_threads);
-
-    for (unsigned int i = 0; i < num_threads; ++i) {
-        threads.emplace_back([&]() {
-            while (success_flag) { // Stop if any thread has failed
-                size_t current_index = next_index.fetch_add(1);
-                if (current_index >= batch_size) break;
-
-                udpipe_doc_view* doc = &results[current_index];
-                doc->sentences = nullptr;
-                doc->count = 0;
-                doc->arena = nullptr;
-                const char* text = utf8_texts[current_index];
-                bool current_success = true;
-
-                auto arena = new StringArena();
-                doc->arena = arena;
-
-                std::unique_ptr<input_format> reader(m->new_tokenizer(""));
-                if (!reader) {
-                    success_flag = false;
-                    continue;
-                }
-                reader->reset_document("");
-                reader->set_text(text);
-
-                std::vector<udpipe_sentence_view> sentences;
-                sentence s;
-                std::string error;
-                while (reader->next_sentence(s, error)) {
-                    if (!error.empty()) { current_success = false; break; }
-                    if (!m->tag(s, model::DEFAULT, error)) { current_success = false; break; }
-                    if (do_parse) {
-                        if (!m->parse(s, model::DEFAULT, error)) { current_success = false; break; }
-                    }
+    for (size_t i = 0; i < batch_size; ++i) {
+        auto task = [&, i]() {
+            if (!success_flag) return;
+            const char* text = utf8_texts[i] ? utf8_texts[i] : "";
+            const size_t len = text_lens ? text_lens[i] : std::strlen(text);
+            try {
+                ReaderPool* reader_pool = nullptr;
+                std::unique_ptr<input_format> reader = readers.checkout(reader_pool);
+                std::string error = reader ? "" : "the model has no tokenizer";
+                const bool ok = reader && tokenize_to_token_doc(*reader, text, len, borrow, &docs[i], error);
+                readers.checkin(reader_pool, std::move(reader));
+                if (!ok) fail(i, error);
+            } catch (...) {
+                fail(i, exception_message());
+            }
+        };
+        try {
+            p.submit(group, std::move(task));
+        } catch (...) {
+            fail(i, "out of memory");
+        }
+    }
+    // A task that threw past its own handling left its document unfinished.
+    if (!p.wait(group)) success_flag = false;
+
+    if (!success_flag) {
+        udpipe_free_token_batch(docs, batch_size);
+        return 0;
+    }
+    *out_docs = docs;
+    *out_size = batch_size;
+    return 1;
+}
+
+extern "C" void udpipe_free_token_batch(udpipe_token_doc* docs, size_t batch_size) {
+    if (!docs) return;
+    for (size_t i = 0; i < batch_size; ++i) release_token_doc(&docs[i], false);
+    std::free(docs);
+}
+
+extern "C" void udpipe_token_batch_recycle(udpipe_token_doc* docs, size_t batch_size) {
+    if (!docs) return;
+    for (size_t i = 0; i < batch_size; ++i) release_token_doc(&docs[i], true);
+    std::free(docs);
+}
+
+extern "C" int udpipe_tag_binary(udpipe_model_t handle, const char* utf8_text, size_t text_len, unsigned int flags,
+                                 char** out_buffer, size_t* out_len) {
+    if (!handle || (!utf8_text && text_len) || !out_buffer || !out_len) return 0;
+    *out_buffer = nullptr;
+    *out_len = 0;
+    DocumentProcessor processor(static_cast<ModelHandle*>(handle), nullptr);
+    *out_buffer = processor.encode(utf8_text ? utf8_text : "", text_len, flags, out_len);
+    return *out_buffer != nullptr;
+}
+
+extern "C" int udpipe_binary_open(const char* buffer, size_t len, udpipe_doc_view* out_doc) {
+    if (!out_doc) return 0;
+    *out_doc = udpipe_doc_view{};
+    if (!buffer) return 0;
+    std::vector<udpipe_token> toks;
+    std::vector<udpipe_sentence_view> sentences;
+    if (!binary_format::decode(buffer, len, toks, sentences)) return 0;
+    auto arena = new StringArena();
+    out_doc->arena = arena;
+    if (publish_tokens(*arena, toks, sentences, out_doc)) return 1;
+    udpipe_free_doc(out_doc);
+    return 0;
+}
+
+extern "C" void udpipe_binary_free(char* buffer) {
+    std::free(buffer);
+}
+
+extern "C" udpipe_session_t udpipe_session_create(udpipe_model_t handle, const char* tokenizer_options) {
+    if (!handle) return nullptr;
+    auto session = new DocumentProcessor(static_cast<ModelHandle*>(handle), tokenizer_options);
+    if (!session->prepare()) {
+        delete session;
+        return nullptr;
+    }
+    return static_cast<udpipe_session_t>(session);
+}
+
+extern "C" void udpipe_session_free(udpipe_session_t session) {
+    if (!session) return;
+    delete static_cast<DocumentProcessor*>(session);
+}
+
+extern "C" int udpipe_session_process(udpipe_session_t session, const char* utf8_text, size_t text_len,
+                                      unsigned int flags, udpipe_doc_view* out_doc) {
+    if (!session || (!utf8_text && text_len) || !out_doc) return 0;
+    return static_cast<DocumentProcessor*>(session)->process(utf8_text ? utf8_text : "", text_len, flags, out_doc);
+}
 
-                    std::vector<udpipe_token> toks;
-                    toks.reserve(s.words.size());
-                    for (const auto& w : s.words) {
-                        if (w.id <= 0) continue;
-                        udpipe_token t{};
-                        t.id = w.id;
-                        t.head = w.head;
-                        t.form = arena->allocate(w.form);
-                        t.lemma = arena->allocate(w.lemma);
-                        t.upos = arena->allocate(w.upostag);
-                        t.xpostag = arena->allocate(w.xpostag);
-                        t.feats = arena->allocate(w.feats);
-                        t.deprel = arena->allocate(w.deprel);
-                        size_t start = 0, end = 0;
-                        if (w.get_token_range(start, end)) { t.start = start; t.end = end; }
-                        toks.push_back(t);
+// Tags a document on demand, one sentence per `next` call. The sentence is
+// built in the stream's own scratch vectors and arena, both of which are
+// recycled on the following call.
+//
+// A stream either reads one caller-owned text, or is fed input piece by piece
+// (through `feed` or from a file descriptor). Fed input is buffered internally
+// and tokenized a window at a time: every sentence of a window except the last
+// is complete, while the last one may continue in the next chunk, so its text
+// is carried over and re-tokenized together with the following input, up to
+// MAX_CARRY bytes. Token offsets count bytes from the start of the stream.
+class SentenceStream {
+    ModelHandle* h_;
+    model* m_;
+    unsigned flags_;
+    TagInterner tags_;
+    std::unique_ptr<input_format> reader_;
+    sentence s_;
+    StringArena arena_;
+    std::vector<udpipe_token> toks_;
+    std::vector<udpipe_sentence_view> sentences_;
+    std::unique_ptr<DocumentBuilder> builder_;
+    size_t emitted_tokens_ = 0;
+    bool failed_ = false;
+
+    // Fed input.
+    bool fed_ = false;
+    bool finished_ = false;
+    int fd_ = -1;
+    std::string window_;               // text of the sentences in `ready_`
+    size_t window_offset_ = 0;         // stream offset of `window_`
+    std::string pending_;              // input not yet tokenized
+    bool pending_changed_ = false;
+    std::deque<sentence> ready_;       // complete sentences of `window_`, not yet tagged
+
+    static constexpr size_t FD_READ_SIZE = 1 << 16;
+    // Longest unfinished sentence carried over to the next window. Carried text is
+    // tokenized again with every window, so a sentence longer than this (input with
+    // no boundaries, such as logs) is cut at the end of the window instead: that
+    // keeps the work linear and the memory bounded.
+    static constexpr size_t MAX_CARRY = 1 << 18;
+
+    // Returns the length of the longest prefix of `text` that doesn't end in the
+    // middle of a UTF-8 sequence.
+    static size_t complete_utf8_prefix(const std::string& text) {
+        size_t n = text.size();
+        size_t k = 0;
+        while (k < 4 && k < n && (static_cast<unsigned char>(text[n - 1 - k]) & 0xC0) == 0x80) ++k;
+        if (k == n) return n;
+        unsigned char lead = static_cast<unsigned char>(text[n - 1 - k]);
+        size_t need = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+        return need > k + 1 ? n - 1 - k : n;
+    }
+
+    // Byte offset within `text` of the first token range in `s`, or `npos`.
+    static size_t sentence_start(const sentence& s, const std::string& text) {
+        size_t start = 0, end = 0;
+        bool found = !s.multiword_tokens.empty() && s.multiword_tokens.front().id_first == 1
+                         ? s.multiword_tokens.front().get_token_range(start, end)
+                         : s.words.size() > 1 && s.words[1].get_token_range(start, end);
+        if (!found) return std::string::npos;
+        return Utf8OffsetMap(text.data(), text.size()).to_bytes(start);
+    }
+
+    // Reads the next chunk from `fd_`. Returns false on a read error.
+    bool read_fd() {
+        char buffer[FD_READ_SIZE];
+        for (;;) {
+            ssize_t n = ::read(fd_, buffer, sizeof(buffer));
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) return false;
+            if (n == 0) finished_ = true;
+            else feed(buffer, static_cast<size_t>(n));
+            return true;
+        }
+    }
+
+    // Tokenizes the pending input into `ready_`. Returns UDPIPE_STREAM_SENTENCE
+    // once there is a sentence to process, or one of the other stream codes.
+    int refill() {
+        while (ready_.empty()) {
+            if (finished_ && pending_.empty()) return UDPIPE_STREAM_END;
+            if (!finished_ && !pending_changed_) {
+                if (fd_ < 0) return UDPIPE_STREAM_NEED_INPUT;
+                if (!read_fd()) return UDPIPE_STREAM_ERROR;
+                continue;
+            }
+
+            window_offset_ += window_.size();
+            window_.swap(pending_);
+            pending_.clear();
+            pending_changed_ = false;
+
+            // Leave a code point split by the chunk edge for the next window.
+            size_t usable = finished_ ? window_.size() : complete_utf8_prefix(window_);
+            pending_.assign(window_, usable, std::string::npos);
+            window_.resize(usable);
+
+            reader_->reset_document("");
+            reader_->set_text(string_piece(window_.data(), window_.size()));
+            std::string error;
+            for (;;) {
+                ready_.emplace_back();
+                if (!read_sentence(*reader_, ready_.back(), error)) break;
+            }
+            ready_.pop_back();
+            if (!error.empty()) return UDPIPE_STREAM_ERROR;
+
+            size_t carry = window_.size();
+            if (!finished_ && !ready_.empty()) {
+                carry = sentence_start(ready_.back(), window_);
+                if (carry == std::string::npos) return UDPIPE_STREAM_ERROR;
+                if (window_.size() - carry <= MAX_CARRY) ready_.pop_back();
+                else carry = window_.size();
+            }
+            if (!finished_) {
+                // Keep the unfinished sentence in front of any input after it.
+                pending_.insert(0, window_, carry, std::string::npos);
+                window_.resize(carry);
+                if (ready_.empty()) pending_changed_ = false;
+            }
+            builder_.reset(new DocumentBuilder(arena_, tags_, window_.data(), window_.size(), flags_, toks_,
+                                               sentences_, window_offset_));
+        }
+        return UDPIPE_STREAM_SENTENCE;
+    }
+
+public:
+    SentenceStream(ModelHandle* h, unsigned flags)
+        : h_(h), m_(h->get()), flags_(resolve_fields(flags & ~static_cast<unsigned>(UDPIPE_OUTPUT_COLUMNS))),
+          tags_(h->vocabulary) {}
+
+    // Creates the tokenizer. Returns false if the model has none.
+    bool prepare(const char* tokenizer_options) {
+        if (!m_) return false;
+        reader_.reset(m_->new_tokenizer(tokenizer_options_with_ranges(tokenizer_options)));
+        return reader_ != nullptr;
+    }
+
+    // Reads the whole of the caller-owned `text`.
+    void set_text(const char* text, size_t text_len) {
+        reader_->set_text(string_piece(text, text_len));
+        builder_.reset(new DocumentBuilder(arena_, tags_, text, text_len, flags_, toks_, sentences_));
+    }
+
+    // Switches to fed input. Forms are never borrowed, as the caller doesn't keep
+    // the chunks they would point into.
+    void set_fed(int fd) {
+        fed_ = true;
+        fd_ = fd;
+        flags_ &= ~static_cast<unsigned>(UDPIPE_BORROW_FORMS);
+    }
+
+    bool fed() const { return fed_; }
+    bool reads_fd() const { return fd_ >= 0; }
+
+    void feed(const char* chunk, size_t len) {
+        pending_.append(chunk, len);
+        pending_changed_ = true;
+    }
+
+    void finish() {
+        finished_ = true;
+        pending_changed_ = true;
+    }
+
+    int next(udpipe_sentence_view* out) {
+        *out = udpipe_sentence_view{};
+        if (failed_) return UDPIPE_STREAM_ERROR;
+
+        arena_.reset();
+        toks_.clear();
+        sentences_.clear();
+        s_.clear();
+
+        std::string error;
+        if (fed_) {
+            int status = refill();
+            if (status != UDPIPE_STREAM_SENTENCE) {
+                if (status == UDPIPE_STREAM_ERROR) failed_ = true;
+                return status;
+            }
+            s_ = std::move(ready_.front());
+            ready_.pop_front();
+        } else if (!read_sentence(*reader_, s_, error)) {
+            if (error.empty()) return UDPIPE_STREAM_END;
+            failed_ = true;
+            return UDPIPE_STREAM_ERROR;
+        }
+
+        const bool do_tag = (flags_ & (UDPIPE_STAGE_TAG | UDPIPE_STAGE_PARSE)) != 0;
+        const bool do_parse = (flags_ & UDPIPE_STAGE_PARSE) != 0;
+        sentence* group = &s_;
+        if (!run_stages(h_, m_, &group, 1, do_tag, do_parse, error)) {
+            failed_ = true;
+            return UDPIPE_STREAM_ERROR;
+        }
+
+        builder_->add_sentence(s_);
+        *out = sentences_.back();
+        out->tokens = toks_.empty() ? nullptr : toks_.data();
+        out->offset = emitted_tokens_;
+        emitted_tokens_ += out->count;
+        return UDPIPE_STREAM_SENTENCE;
+    }
+};
+
+extern "C" udpipe_stream_t udpipe_stream_open(udpipe_model_t handle, const char* utf8_text, size_t text_len,
+                                               const char* tokenizer_options, unsigned int flags) {
+    if (!handle || (!utf8_text && text_len)) return nullptr;
+    auto stream = new SentenceStream(static_cast<ModelHandle*>(handle), flags);
+    if (!stream->prepare(tokenizer_options)) {
+        delete stream;
+        return nullptr;
+    }
+    stream->set_text(utf8_text ? utf8_text : "", text_len);
+    return static_cast<udpipe_stream_t>(stream);
+}
+
+extern "C" udpipe_stream_t udpipe_stream_create(udpipe_model_t handle, const char* tokenizer_options,
+                                                 unsigned int flags) {
+    if (!handle) return nullptr;
+    auto stream = new SentenceStream(static_cast<ModelHandle*>(handle), flags);
+    if (!stream->prepare(tokenizer_options)) {
+        delete stream;
+        return nullptr;
+    }
+    stream->set_fed(-1);
+    return static_cast<udpipe_stream_t>(stream);
+}
+
+extern "C" udpipe_stream_t udpipe_stream_open_fd(udpipe_model_t handle, int fd, const char* tokenizer_options,
+                                                  unsigned int flags) {
+    if (!handle || fd < 0) return nullptr;
+    auto stream = new SentenceStream(static_cast<ModelHandle*>(handle), flags);
+    if (!stream->prepare(tokenizer_options)) {
+        delete stream;
+        return nullptr;
+    }
+    stream->set_fed(fd);
+    return static_cast<udpipe_stream_t>(stream);
+}
+
+extern "C" int udpipe_stream_feed(udpipe_stream_t stream, const char* utf8_chunk, size_t chunk_len) {
+    if (!stream || (!utf8_chunk && chunk_len)) return 0;
+    auto s = static_cast<SentenceStream*>(stream);
+    if (!s->fed() || s->reads_fd()) return 0;
+    if (chunk_len) s->feed(utf8_chunk, chunk_len);
+    return 1;
+}
+
+extern "C" int udpipe_stream_finish(udpipe_stream_t stream) {
+    if (!stream) return 0;
+    auto s = static_cast<SentenceStream*>(stream);
+    if (!s->fed() || s->reads_fd()) return 0;
+    s->finish();
+    return 1;
+}
+
+extern "C" int udpipe_stream_next(udpipe_stream_t stream, udpipe_sentence_view* out_sentence) {
+    if (!stream || !out_sentence) return UDPIPE_STREAM_ERROR;
+    return static_cast<SentenceStream*>(stream)->next(out_sentence);
+}
+
+extern "C" void udpipe_stream_close(udpipe_stream_t stream) {
+    if (!stream) return;
+    delete static_cast<SentenceStream*>(stream);
+}
+
+// Number of sentences tagged per work-stealing task in `udpipe_tag_batch`.
+// Small enough that one long document spreads over all workers, large enough
+// to keep per-task scheduling overhead negligible next to tagging. Each task
+// is also one run_stages group.
+static constexpr size_t BATCH_SENTENCES_PER_TASK = STAGE_GROUP_SENTENCES;
+
+// Sentence tasks a document may have queued or running before its tokenizer tags
+// further sentences itself, per pool worker. Bounds how far tokenization runs ahead
+// of tagging, and with it the memory held by a long document's pending sentences.
+static constexpr size_t BATCH_PENDING_TASKS_PER_WORKER = 4;
+
+// A run of consecutive sentences of one document, tagged by one task.
+struct BatchChunk {
+    std::vector<sentence> sentences;
+    std::atomic<bool> done{false};
+    // The chunk that follows this one in the document; set under the document's
+    // assembly mutex.
+    BatchChunk* next = nullptr;
+};
+
+// A document's output under construction. Finished chunks are marshalled in document
+// order as soon as all earlier ones are, so sentences are freed as they are tagged
+// and the offsets come out exactly as the sequential path computes them.
+struct BatchAssembly {
+    TagInterner tags;
+    std::vector<udpipe_token> toks;
+    std::vector<udpipe_sentence_view> views;
+    DocumentBuilder builder;
+
+    BatchAssembly(StringArena& arena, TagVocabulary& vocabulary, const char* text, size_t text_len, unsigned flags)
+        : tags(vocabulary), builder(arena, tags, text, text_len, flags, toks, views) {}
+};
+
+// Per-document state shared by the tasks working on one batch entry.
+struct BatchDocument {
+    size_t index = 0;
+    const char* text = nullptr;
+    size_t text_len = 0;
+    // Appended to by the tokenizer only; std::deque keeps the chunks other workers
+    // are tagging in place, and tasks get chunk pointers rather than indices.
+    std::deque<BatchChunk> chunks;
+    // One count per outstanding sentence task plus one held by the tokenizer task;
+    // whoever drops it to zero publishes the document.
+    std::atomic<size_t> remaining{1};
+    std::atomic<bool> failed{false};
+    // Bookkeeping for UDPIPE_SKIP_BAD_SENTENCES and the document's error message.
+    std::atomic<size_t> skipped{0};
+    std::mutex error_mutex;
+    std::string failure;
+    std::string skip_error;
+    // Ordered reassembly: `first_pending` is the oldest chunk not yet marshalled and
+    // `last` the newest chunk, both guarded by the mutex. `assembly` is created before
+    // the first chunk and then only used under the mutex.
+    std::mutex assembly_mutex;
+    std::unique_ptr<BatchAssembly> assembly;
+    BatchChunk* first_pending = nullptr;
+    BatchChunk* last = nullptr;
+
+    // Keeps the first error for `slot`. Never throws: if the message can't be copied
+    // the document still fails or is partial, with the generic message.
+    void note_error(std::string& slot, const std::string& error) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!slot.empty()) return;
+        try {
+            slot = error;
+        } catch (...) {
+        }
+    }
+};
+
+// State of one batch call. Its tasks share ownership of it, so an asynchronous
+// batch outlives the call that started it; it keeps the model retained until then.
+//
+// By default the batch is all-or-nothing, as `udpipe_tag_batch` is: the first failure
+// stops the remaining work and the caller discards every document. With
+// UDPIPE_PARTIAL_BATCH, and always with `on_document`, each document succeeds or fails
+// on its own; the callback gets it as soon as it is assembled.
+class BatchJob : public std::enable_shared_from_this<BatchJob> {
+public:
+    BatchJob(ModelHandle* h, WorkerPool& pool, WorkerPool::TaskGroup* group, unsigned flags,
+             udpipe_doc_callback on_document, void* context, const char** utf8_texts, const size_t* text_lens,
+             size_t batch_size)
+        : h_(h), pool_(pool), group_(group), flags_(resolve_fields(flags)), on_document_(on_document),
+          context_(context),
+          all_or_nothing_(!on_document && !(flags & UDPIPE_PARTIAL_BATCH)),
+          max_pending_tasks_(BATCH_PENDING_TASKS_PER_WORKER * std::max<size_t>(pool.size(), 1)),
+          results_(batch_size), documents_(batch_size) {
+        udpipe_model_retain(h_);
+        for (size_t i = 0; i < batch_size; ++i) {
+            documents_[i].index = i;
+            documents_[i].text = utf8_texts[i] ? utf8_texts[i] : "";
+            documents_[i].text_len = text_lens ? text_lens[i] : std::strlen(documents_[i].text);
+        }
+    }
+
+    ~BatchJob() { udpipe_model_free(h_); }
+
+    BatchJob(const BatchJob&) = delete;
+    BatchJob& operator=(const BatchJob&) = delete;
+
+    // Queues the tokenizer task of every document.
+    void start() {
+        for (auto& bd : documents_) {
+            BatchDocument* doc = &bd;
+            try {
+                submit([self = shared_from_this(), doc]() { self->tokenize_document(*doc); });
+            } catch (...) {
+                // Report the document as failed rather than never finishing it.
+                fail(bd, "out of memory");
+                release(bd);
+            }
+        }
+    }
+
+    bool succeeded() const { return success_; }
+    std::vector<udpipe_doc_view>& results() { return results_; }
+
+private:
+    void submit(std::function<void()> task) {
+        if (group_) pool_.submit(*group_, std::move(task));
+        else pool_.submit_background(std::move(task));
+    }
+
+    bool should_run(const BatchDocument& bd) const { return success_ && !bd.failed; }
+
+    void fail(BatchDocument& bd, const std::string& error) {
+        bd.failed = true;
+        if (all_or_nothing_) success_ = false;
+        bd.note_error(bd.failure, error);
+    }
+
+    // Appends a chunk holding `sentences` to the document's reassembly order.
+    BatchChunk* add_chunk(BatchDocument& bd, std::vector<sentence>&& sentences) {
+        bd.chunks.emplace_back();
+        BatchChunk* chunk = &bd.chunks.back();
+        chunk->sentences = std::move(sentences);
+        std::lock_guard<std::mutex> lock(bd.assembly_mutex);
+        if (bd.last) bd.last->next = chunk;
+        if (!bd.first_pending) bd.first_pending = chunk;
+        bd.last = chunk;
+        return chunk;
+    }
+
+    // Marshals the finished chunks at the front of the reassembly order and frees
+    // their sentences, leaving out those cleared by UDPIPE_SKIP_BAD_SENTENCES.
+    void assemble_ready(BatchDocument& bd) {
+        std::lock_guard<std::mutex> lock(bd.assembly_mutex);
+        bool keep = should_run(bd) && bd.assembly;
+        while (bd.first_pending && bd.first_pending->done) {
+            BatchChunk* chunk = bd.first_pending;
+            if (keep) {
+                try {
+                    for (auto& s : chunk->sentences) {
+                        if (!s.empty()) bd.assembly->builder.add_sentence(s);
                     }
-                    udpipe_sentence_view view{};
-                    view.count = toks.size();
-                    view.tokens = (udpipe_token*)std::malloc(sizeof(udpipe_token) * view.count);
-                    if (!view.tokens) { error = "alloc failure"; current_success = false; break; }
-                    std::memcpy(view.tokens, toks.data(), sizeof(udpipe_token) * view.count);
-                    sentences.push_back(view);
-                    s.clear();
+                } catch (...) {
+                    fail(bd, exception_message());
+                    keep = false;
                 }
+            }
+            std::vector<sentence>().swap(chunk->sentences);
+            bd.first_pending = chunk->next;
+        }
+    }
 
-                if (!error.empty()) { current_success = false; }
-
-                if (!current_success) {
-                    success_flag = false;
-                    udpipe_doc_view tmp{sentences.data(), sentences.size()};
-                    udpipe_free_doc(&tmp);
-                    continue;
+    // Drops one reference on `bd`; the last one publishes the finished document.
+    void release(BatchDocument& bd) {
+        if (bd.remaining.fetch_sub(1) != 1) return;
+        udpipe_doc_view* doc = &results_[bd.index];
+        assemble_ready(bd);
+        try {
+            if (should_run(bd) && bd.assembly) {
+                if (bd.assembly->builder.publish(doc)) {
+                    set_partial_outcome(*static_cast<StringArena*>(doc->arena), bd.skipped, bd.skip_error, doc);
+                } else {
+                    fail(bd, "out of memory");
                 }
+            }
+        } catch (...) {
+            fail(bd, exception_message());
+        }
+        bd.assembly.reset();
+        bd.chunks.clear();
+        if (all_or_nothing_) return;
 
-                doc->count = sentences.size();
-                doc->sentences = (udpipe_sentence_view*)std::malloc(sizeof(udpipe_sentence_view) * doc->count);
-                if (!doc->sentences) {
-                    doc->count = 0;
-                    success_flag = false;
-                    udpipe_doc_view tmp{sentences.data(), sentences.size()};
-                    udpipe_free_doc(&tmp);
-                    continue;
+        if (bd.failed) {
+            try {
+                set_failed_outcome(bd.failure, doc);
+            } catch (...) {
+                // No arena for the message: report the failure without one.
+                udpipe_free_doc(doc);
+                doc->status = UDPIPE_DOC_FAILED;
+            }
+        }
+        if (on_document_) on_document_(context_, bd.index, bd.failed ? 0 : 1, doc);
+    }
+
+    // Tags and optionally parses the sentences of `chunk`, then hands it to reassembly.
+    // Workers of a NUMA-grouped pool use their node's copy of the model, if there is one.
+    void tag_chunk(BatchDocument& bd, BatchChunk& chunk) {
+        const bool do_tag = (flags_ & (UDPIPE_STAGE_TAG | UDPIPE_STAGE_PARSE)) != 0;
+        const bool do_parse = (flags_ & UDPIPE_STAGE_PARSE) != 0;
+        model* m = h_->for_node(WorkerPool::current_node());
+        std::string error;
+        if (should_run(bd)) {
+            try {
+                std::vector<sentence*> range;
+                range.reserve(chunk.sentences.size());
+                for (auto& s : chunk.sentences) range.push_back(&s);
+                if (flags_ & UDPIPE_SKIP_BAD_SENTENCES) {
+                    bd.skipped += run_stages_skipping(h_, m, range.data(), range.size(), do_tag, do_parse, error);
+                    if (!error.empty()) bd.note_error(bd.skip_error, error);
+                } else if (!run_stages(h_, m, range.data(), range.size(), do_tag, do_parse, error)) {
+                    fail(bd, error);
                 }
-                std::memcpy(doc->sentences, sentences.data(), sizeof(udpipe_sentence_view) * doc->count);
+            } catch (...) {
+                fail(bd, exception_message());
             }
-        });
+        }
+        chunk.done = true;
+        assemble_ready(bd);
+        release(bd);
     }
 
-    for (auto& t : threads) {
-        t.join();
+    // The tokenizer task of `bd`. Whatever happens, it drops the tokenizer's
+    // reference, so the document is always published.
+    void tokenize_document(BatchDocument& bd) {
+        if (should_run(bd)) {
+            try {
+                tokenize_into_chunks(bd);
+            } catch (...) {
+                fail(bd, exception_message());
+            }
+        }
+        release(bd);
     }
 
-    if (!success_flag) {
+    // Segments the document and fans its sentences out as work-stealing tasks
+    // while it keeps tokenizing. Once `max_pending_tasks_` of them are outstanding
+    // it tags the next chunk itself, which keeps the backlog bounded.
+    void tokenize_into_chunks(BatchDocument& bd) {
+        ReaderPool* readers = nullptr;
+        std::unique_ptr<input_format> reader = checkout_reader(h_, WorkerPool::current_node(), readers);
+        if (!reader) {
+            fail(bd, "the model has no tokenizer");
+            return;
+        }
+        auto arena = new StringArena();
+        results_[bd.index].arena = arena;
+        bd.assembly.reset(new BatchAssembly(*arena, h_->vocabulary, bd.text, bd.text_len, flags_));
+        reader->reset_document("");
+        reader->set_text(string_piece(bd.text, bd.text_len));
+
+        std::vector<sentence> pending;
+        auto flush = [&]() {
+            if (pending.empty()) return;
+            BatchChunk* chunk = add_chunk(bd, std::move(pending));
+            pending = std::vector<sentence>();
+            if (bd.remaining.fetch_add(1) > max_pending_tasks_) {
+                tag_chunk(bd, *chunk);
+                return;
+            }
+            try {
+                submit([self = shared_from_this(), &bd, chunk]() { self->tag_chunk(bd, *chunk); });
+            } catch (...) {
+                // The chunk holds a reference and must finish: tag it here instead.
+                tag_chunk(bd, *chunk);
+            }
+        };
+
+        std::string error;
+        pending.reserve(BATCH_SENTENCES_PER_TASK);
+        pending.emplace_back();
+        while (should_run(bd) && read_sentence(*reader, pending.back(), error)) {
+            if (!error.empty()) break;
+            if (pending.size() >= BATCH_SENTENCES_PER_TASK) {
+                flush();
+                pending.reserve(BATCH_SENTENCES_PER_TASK);
+            }
+            pending.emplace_back();
+        }
+        // The last element is the unused read target.
+        pending.pop_back();
+        checkin_reader(readers, std::move(reader));
+        // Skipping keeps the sentences read before a tokenizer error.
+        if (!error.empty()) {
+            if (flags_ & UDPIPE_SKIP_BAD_SENTENCES) bd.note_error(bd.skip_error, error);
+            else fail(bd, error);
+        }
+        flush();
+    }
+
+    ModelHandle* h_;
+    WorkerPool& pool_;
+    WorkerPool::TaskGroup* group_; // NULL for the pool's background group
+    unsigned flags_;
+    udpipe_doc_callback on_document_;
+    void* context_;
+    const bool all_or_nothing_;
+    const size_t max_pending_tasks_;
+    std::vector<udpipe_doc_view> results_;
+    std::vector<BatchDocument> documents_;
+    std::atomic<bool> success_{true};
+};
+
+// Runs a batch on `pool`. `text_lens` may be NULL for NUL-terminated texts.
+static int tag_batch_on(ModelHandle* h, WorkerPool& pool, const char** utf8_texts, const size_t* text_lens,
+                        size_t batch_size, unsigned flags, udpipe_doc_view** out_docs, size_t* out_size) {
+    *out_docs = nullptr;
+    *out_size = 0;
+
+    if (!h->get()) return 0;
+    WorkerPool::TaskGroup group;
+    std::shared_ptr<BatchJob> job;
+    try {
+        job = std::make_shared<BatchJob>(h, pool, &group, flags, nullptr, nullptr, utf8_texts, text_lens,
+                                         batch_size);
+    } catch (...) {
+        return 0;
+    }
+    job->start();
+    // A task that threw past its own handling left its document unfinished.
+    const bool finished = pool.wait(group);
+
+    std::vector<udpipe_doc_view>& results = job->results();
+    if (!finished || !job->succeeded()) {
         for(size_t i = 0; i < results.size(); ++i) {
             udpipe_free_doc(&results[i]);
         }
@@ -407,6 +1936,146 @@ extern "C" int udpipe_tag_batch(udpipe_model_t handle, const char** utf8_texts,
     return 1;
 }
 
+extern "C" int udpipe_tag_batch(udpipe_model_t handle, const char** utf8_texts, size_t batch_size, int do_parse,
+                                 udpipe_doc_view** out_docs, size_t* out_size) {
+    if (!handle || !utf8_texts || !out_docs || !out_size) return 0;
+    return tag_batch_on(static_cast<ModelHandle*>(handle), WorkerPool::shared(), utf8_texts, nullptr, batch_size,
+                        UDPIPE_STAGE_TAG | (do_parse ? UDPIPE_STAGE_PARSE : 0), out_docs, out_size);
+}
+
+extern "C" int udpipe_tag_batch_pool(udpipe_model_t handle, udpipe_pool_t pool, const char** utf8_texts,
+                                      size_t batch_size, int do_parse,
+                                      udpipe_doc_view** out_docs, size_t* out_size) {
+    if (!handle || !pool || !utf8_texts || !out_docs || !out_size) return 0;
+    return tag_batch_on(static_cast<ModelHandle*>(handle), *static_cast<WorkerPool*>(pool), utf8_texts, nullptr,
+                        batch_size, UDPIPE_STAGE_TAG | (do_parse ? UDPIPE_STAGE_PARSE : 0), out_docs, out_size);
+}
+
+extern "C" int udpipe_tag_batch_ex(udpipe_model_t handle, udpipe_pool_t pool, const char** utf8_texts,
+                                    const size_t* text_lens, size_t batch_size, unsigned int flags,
+                                    udpipe_doc_view** out_docs, size_t* out_size) {
+    if (!handle || !utf8_texts || !out_docs || !out_size) return 0;
+    WorkerPool& p = pool ? *static_cast<WorkerPool*>(pool) : WorkerPool::shared();
+    return tag_batch_on(static_cast<ModelHandle*>(handle), p, utf8_texts, text_lens, batch_size, flags, out_docs,
+                        out_size);
+}
+
+extern "C" int udpipe_tag_structured_parallel(udpipe_model_t handle, udpipe_pool_t pool, const char* utf8_text,
+                                               size_t text_len, unsigned int flags, udpipe_doc_view* out_doc) {
+    if (!handle || (!utf8_text && text_len) || !out_doc) return 0;
+    *out_doc = udpipe_doc_view{};
+    WorkerPool& p = pool ? *static_cast<WorkerPool*>(pool) : WorkerPool::shared();
+    const char* texts[1] = {utf8_text ? utf8_text : ""};
+    udpipe_doc_view* docs = nullptr;
+    size_t size = 0;
+    flags &= ~static_cast<unsigned>(UDPIPE_PARTIAL_BATCH);
+    if (!tag_batch_on(static_cast<ModelHandle*>(handle), p, texts, &text_len, 1, flags, &docs, &size)) return 0;
+    *out_doc = docs[0];
+    std::free(docs);
+    return 1;
+}
+
+extern "C" int udpipe_tag_batch_async(udpipe_model_t handle, udpipe_pool_t pool, const char** utf8_texts,
+                                       const size_t* text_lens, size_t batch_size, unsigned int flags,
+                                       udpipe_doc_callback on_document, void* context) {
+    if (!handle || !utf8_texts || !on_document) return 0;
+    auto h = static_cast<ModelHandle*>(handle);
+    if (!h->get()) return 0;
+    WorkerPool& p = pool ? *static_cast<WorkerPool*>(pool) : WorkerPool::shared();
+    try {
+        auto job = std::make_shared<BatchJob>(h, p, nullptr, flags, on_document, context, utf8_texts, text_lens,
+                                              batch_size);
+        job->start();
+    } catch (...) {
+        return 0;
+    }
+    return 1;
+}
+
+extern "C" udpipe_pool_t udpipe_pool_create(size_t num_threads) {
+    try {
+        return static_cast<udpipe_pool_t>(new WorkerPool(num_threads));
+    } catch (...) {
+        // std::thread reports resource exhaustion through std::system_error.
+        return nullptr;
+    }
+}
+
+extern "C" void udpipe_pool_free(udpipe_pool_t pool) {
+    if (!pool) return;
+    delete static_cast<WorkerPool*>(pool);
+}
+
+extern "C" udpipe_pool_t udpipe_pool_create_ex(const udpipe_pool_options* options) {
+    if (!options || (options->cpu_count && !options->cpus)) return nullptr;
+    WorkerPool::Options opts;
+    opts.num_threads = options->num_threads;
+    opts.cpus.assign(options->cpus, options->cpus + options->cpu_count);
+    opts.pin = (options->flags & UDPIPE_POOL_PIN_THREADS) != 0;
+    opts.numa = (options->flags & UDPIPE_POOL_NUMA) != 0;
+    opts.max_nodes = options->max_nodes;
+    try {
+        return static_cast<udpipe_pool_t>(new WorkerPool(opts));
+    } catch (...) {
+        // No usable CPU, or the threads couldn't be started.
+        return nullptr;
+    }
+}
+
+extern "C" size_t udpipe_pool_size(udpipe_pool_t pool) {
+    if (!pool) return 0;
+    return static_cast<WorkerPool*>(pool)->size();
+}
+
+extern "C" size_t udpipe_pool_node_count(udpipe_pool_t pool) {
+    if (!pool) return 0;
+    const auto& groups = static_cast<WorkerPool*>(pool)->groups();
+    return groups[0].node < 0 ? 1 : groups.size();
+}
+
+extern "C" size_t udpipe_numa_node_count(void) {
+    return cpu_topology::nodes().size();
+}
+
+extern "C" int udpipe_model_replicate(udpipe_model_t handle, udpipe_pool_t pool) {
+    if (!handle || !pool) return 0;
+    auto h = static_cast<ModelHandle*>(handle);
+    if (!h->get()) return 0;
+    std::lock_guard<std::mutex> lock(h->replicate_mutex);
+
+    WorkerPool& p = *static_cast<WorkerPool*>(pool);
+    std::vector<size_t> missing; // indices into p.groups()
+    for (size_t g = 0; g < p.groups().size(); ++g) {
+        const int node = p.groups()[g].node;
+        if (node < 0 || node == h->home_node) continue;
+        if (static_cast<size_t>(node) >= MAX_REPLICA_NODES) return 0;
+        if (!h->replicas[node].load(std::memory_order_acquire)) missing.push_back(g);
+    }
+    if (missing.empty()) return 1;
+    const std::string& path = h->deferred_path.empty() ? h->path : h->deferred_path;
+    if (path.empty()) return 0;
+
+    // Load each copy on a worker of its node, so that the node's memory backs the
+    // weights (Linux allocates pages on the node that first touches them).
+    std::vector<model*> loaded(missing.size(), nullptr);
+    WorkerPool::TaskGroup group;
+    bool ok = true;
+    for (size_t i = 0; i < missing.size(); ++i) {
+        try {
+            p.submit_to_group(missing[i], group, [&loaded, &path, i]() { loaded[i] = load_model_file(path.c_str()); });
+        } catch (...) {
+            ok = false;
+        }
+    }
+    if (!p.wait(group)) ok = false;
+
+    for (size_t i = 0; i < missing.size(); ++i) {
+        if (loaded[i]) h->replicas[p.groups()[missing[i]].node].store(loaded[i], std::memory_order_release);
+        else ok = false;
+    }
+    return ok ? 1 : 0;
+}
+
 extern "C" void udpipe_free_batch(udpipe_doc_view* docs, size_t batch_size) {
     if (!docs) return;
     for (size_t i = 0; i < batch_size; ++i) {
@@ -414,3 +2083,11 @@ extern "C" void udpipe_free_batch(udpipe_doc_view* docs, size_t batch_size) {
     }
     std::free(docs);
 }
+
+extern "C" void udpipe_batch_recycle(udpipe_doc_view* docs, size_t batch_size) {
+    if (!docs) return;
+    for (size_t i = 0; i < batch_size; ++i) {
+        udpipe_doc_recycle(&docs[i]);
+    }
+    std::free(docs);
+}
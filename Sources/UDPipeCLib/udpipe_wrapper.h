@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stddef.h> // for size_t
+#include <stdint.h> // for uint16_t
 
 #ifdef __cplusplus
 // By including the core C++ header here, guarded for C++, we make the
@@ -22,12 +23,60 @@ typedef void* udpipe_model_t;
 // Opaque handle for a memory arena used for string allocations.
 typedef void* udpipe_arena_t;
 
-// Load a UDPipe model from file path. Returns NULL on failure.
+// Load a UDPipe model from file path. The file is memory-mapped and decoded straight
+// from the page cache, falling back to buffered reads where mapping is not possible.
+// Returns NULL on failure.
 udpipe_model_t udpipe_model_load(const char* model_path);
 
-// Release a model loaded by udpipe_model_load.
+// Open a UDPipe model without loading it yet: the file is only checked to exist, and
+// is loaded by the first call that processes text with the model (concurrent first
+// calls wait for the one load). Useful when many models are opened but only some are
+// used. If the deferred load fails, every processing call fails. Returns NULL if the
+// file doesn't exist.
+udpipe_model_t udpipe_model_load_lazy(const char* model_path);
+
+// Load a UDPipe model from `size` bytes of a .udpipe file already in memory (for example
+// embedded in the executable or in a shared memory segment). The buffer is only read
+// during the call. Returns NULL on failure.
+udpipe_model_t udpipe_model_load_memory(const void* data, size_t size);
+
+// Release a model loaded by udpipe_model_load. Models are refcounted: this drops one
+// reference and frees the model when the last one is gone.
 void udpipe_model_free(udpipe_model_t model);
 
+// Take an additional reference to `model`, to be dropped with udpipe_model_free.
+void udpipe_model_retain(udpipe_model_t model);
+
+// Model registry
+// --------------
+// Shares loaded models across callers. Each path is loaded once, however many callers
+// ask for it concurrently. When a model file changes on disk (modification time or
+// size), the registry keeps serving the loaded model, reloads the file in the
+// background and then swaps the new model in; callers holding the old model keep
+// it until they release it. With a memory budget, least recently acquired models
+// are dropped from the registry until the sum of their file sizes fits.
+typedef void* udpipe_registry_t;
+
+// Create a registry. `memory_budget` is in bytes; 0 means unlimited.
+// Returns NULL on failure.
+udpipe_registry_t udpipe_registry_create(size_t memory_budget);
+
+// Release a registry and its references to models. Models acquired from it stay valid
+// until released. No call may be using the registry.
+void udpipe_registry_free(udpipe_registry_t registry);
+
+// Return a retained handle for the model at `model_path`, loading it if needed, or NULL
+// on failure. Release it with udpipe_model_free.
+udpipe_model_t udpipe_registry_acquire(udpipe_registry_t registry, const char* model_path);
+
+// Start loading (or refreshing) `model_path` in the background.
+// Returns 1 if the file exists, 0 otherwise.
+int udpipe_registry_preload(udpipe_registry_t registry, const char* model_path);
+
+// Bytes (by model file size) of the models held by the registry, and their number.
+size_t udpipe_registry_memory_usage(udpipe_registry_t registry);
+size_t udpipe_registry_size(udpipe_registry_t registry);
+
 // Tag the given UTF-8 text and return CoNLL-U as a newly allocated C string.
 // Caller must free with udpipe_string_free.
 char* udpipe_tag_conllu(udpipe_model_t model, const char* utf8_text);
@@ -35,31 +84,173 @@ char* udpipe_tag_conllu(udpipe_model_t model, const char* utf8_text);
 // Free a string returned by this API.
 void udpipe_string_free(char* p);
 
+// Tag vocabularies
+// ----------------
+// UPOS, XPOS, FEATS and DEPREL values come from small closed sets, so each model
+// interns them: tokens point at the shared strings and carry their ids. Interned
+// strings stay valid until the model is freed. Id 0 is always the empty string.
+enum {
+    UDPIPE_FIELD_UPOS = 0,
+    UDPIPE_FIELD_XPOS = 1,
+    UDPIPE_FIELD_FEATS = 2,
+    UDPIPE_FIELD_DEPREL = 3,
+    UDPIPE_TAG_FIELD_COUNT = 4,
+};
+
+// Id used when a field's vocabulary is full; the value is then stored in the
+// document arena instead and only the string pointer is meaningful.
+#define UDPIPE_NO_TAG_ID 0xFFFF
+
+// Number of values interned so far for `field` (one of UDPIPE_FIELD_*). The
+// vocabulary grows as new values are seen, never shrinks.
+size_t udpipe_vocab_size(udpipe_model_t model, int field);
+
+// The value with the given id, or NULL if `id` is out of range.
+const char* udpipe_vocab_entry(udpipe_model_t model, int field, size_t id);
+
+// Sentence cache
+// --------------
+// Repeated sentences (boilerplate, headlines, templated messages) can skip the tagger and
+// parser: with a cache enabled, the annotations of every tokenized sentence are kept in a
+// bounded LRU keyed by its words and the stages run, and later occurrences are annotated
+// from there. Results are the same as without the cache. The cache is per model and safe
+// to use from concurrent calls.
+typedef struct {
+    uint64_t hits;    // sentences annotated from the cache
+    uint64_t misses;  // sentences that were tagged (and parsed) and then cached
+    uint64_t entries; // sentences currently cached
+} udpipe_cache_stats;
+
+// Enable a sentence cache holding up to `capacity` sentences, replacing (and clearing) any
+// previous one; 0 disables caching. Returns 1 on success, 0 on failure.
+int udpipe_model_set_sentence_cache(udpipe_model_t model, size_t capacity);
+
+// Counters of the model's current sentence cache (all zero without one).
+void udpipe_model_sentence_cache_stats(udpipe_model_t model, udpipe_cache_stats* out_stats);
+
+// Processing flags
+// ----------------
+// Accepted by the `flags` argument of the *_ex, session and later entry points. With no
+// stage bits set, text is only tokenized (as in udpipe_tokenize_structured).
+enum {
+    UDPIPE_STAGE_TAG = 1 << 0,   // lemmas, UPOS, XPOS and FEATS
+    UDPIPE_STAGE_PARSE = 1 << 1, // heads and dependency relations; implies UDPIPE_STAGE_TAG
+    // Leave `form` NULL on tokens whose form is the verbatim input slice
+    // [start, end), i.e. that don't have UDPIPE_TOKEN_FORM_DIFFERS set. Callers read
+    // such forms from their own input buffer, which saves a copy per token.
+    UDPIPE_BORROW_FORMS = 1 << 2,
+    // Return the document as columns in `udpipe_doc_view.columns` instead of a token
+    // array (see udpipe_columns). Forms are then always copied. Ignored by streams.
+    UDPIPE_OUTPUT_COLUMNS = 1 << 3,
+    // Batch calls only: keep the documents that succeed when others fail, instead of
+    // failing the whole batch. The call then returns 0 only if the batch could not run
+    // at all; failed documents come back empty with `status` UDPIPE_DOC_FAILED.
+    UDPIPE_PARTIAL_BATCH = 1 << 4,
+    // Drop the sentences the tagger or parser fails on instead of failing the document,
+    // and keep the sentences read before a tokenizer error. Such documents succeed with
+    // `status` UDPIPE_DOC_PARTIAL. Ignored by streams.
+    UDPIPE_SKIP_BAD_SENTENCES = 1 << 5,
+    // Field selection. With any UDPIPE_WANT_* bit set, only the selected fields are
+    // filled in; the others are left empty (empty strings, vocabulary id 0, head -1) and
+    // cost no copies. Stages that no selected field needs are skipped: without
+    // UDPIPE_WANT_DEPS the parser doesn't run, and if neither the parser nor any tagger
+    // field is needed, neither does the tagger. With no UDPIPE_WANT_* bit set, every
+    // field the requested stages produce is filled in. Ignored by tokenize-only calls.
+    UDPIPE_WANT_LEMMA = 1 << 6,
+    UDPIPE_WANT_UPOS = 1 << 7,
+    UDPIPE_WANT_XPOS = 1 << 8,
+    UDPIPE_WANT_FEATS = 1 << 9,
+    UDPIPE_WANT_DEPS = 1 << 10, // heads and dependency relations
+    UDPIPE_WANT_ALL = UDPIPE_WANT_LEMMA | UDPIPE_WANT_UPOS | UDPIPE_WANT_XPOS | UDPIPE_WANT_FEATS | UDPIPE_WANT_DEPS,
+};
+
+// Values of udpipe_doc_view.status.
+enum {
+    UDPIPE_DOC_OK = 0,
+    UDPIPE_DOC_PARTIAL = 1, // sentences were dropped (UDPIPE_SKIP_BAD_SENTENCES)
+    UDPIPE_DOC_FAILED = 2,  // nothing was produced (UDPIPE_PARTIAL_BATCH, asynchronous batches)
+};
+
 // Structured tagging API
 // ----------------------
 // Simple C token representation to avoid parsing textual formats in Swift.
 typedef struct {
     int id;           // 1-based token id within sentence
     int head;         // head id (0=root), -1 if unavailable
-    const char* form;     // token surface form
+    const char* form;     // token surface form; NULL if borrowed (see UDPIPE_BORROW_FORMS)
     const char* lemma;    // lemma (may be empty)
-    const char* upos;     // UPOS tag (may be empty)
-    const char* xpostag;  // XPOS tag (may be empty)
-    const char* feats;    // FEATS string (may be empty)
-    const char* deprel;   // dependency relation (may be empty)
-    size_t start;     // UTF-8 byte start offset in input, if available
-    size_t end;       // UTF-8 byte end offset (exclusive), if available
+    const char* upos;     // UPOS tag (may be empty); interned, owned by the model
+    const char* xpostag;  // XPOS tag (may be empty); interned, owned by the model
+    const char* feats;    // FEATS string (may be empty); interned, owned by the model
+    const char* deprel;   // dependency relation (may be empty); interned, owned by the model
+    size_t start;     // UTF-8 byte start offset in input (0 if unavailable)
+    size_t end;       // UTF-8 byte end offset (exclusive; 0 if unavailable)
+    uint16_t upos_id;     // vocabulary ids of the fields above (see udpipe_vocab_entry)
+    uint16_t xpostag_id;
+    uint16_t feats_id;
+    uint16_t deprel_id;
+    uint16_t flags;       // UDPIPE_TOKEN_* bits
 } udpipe_token;
 
+// Token flags.
+enum {
+    // `form` is not a verbatim copy of the input bytes [start, end): the token has no
+    // range, is part of a multiword token, or the tokenizer normalised it.
+    UDPIPE_TOKEN_FORM_DIFFERS = 1 << 0,
+};
+
 typedef struct {
-    udpipe_token* tokens;
+    udpipe_token* tokens; // first token of the sentence, inside udpipe_doc_view.tokens
     size_t count;
+    size_t offset;        // index of `tokens` within udpipe_doc_view.tokens
 } udpipe_sentence_view;
 
+// Columnar output
+// ---------------
+// With UDPIPE_OUTPUT_COLUMNS, a document's tokens come as one array per field, so a
+// scan over one or two fields (say lemma and UPOS over millions of tokens) reads only
+// those. Token i of the document is entry i of every per-token array. Strings are packed
+// back to back without terminators, Arrow style: token i's lemma is the bytes
+// lemmas[lemma_offsets[i]] .. lemmas[lemma_offsets[i + 1]]. Tag values are vocabulary ids
+// only (see udpipe_vocab_entry); a value that found its field's vocabulary full reads as
+// UDPIPE_NO_TAG_ID. Documents whose text or packed strings exceed 4 GiB fail.
+typedef struct {
+    const int32_t* ids;          // 1-based word id within the sentence
+    const int32_t* heads;        // head id (0=root), -1 if unavailable
+    const uint16_t* upos_ids;
+    const uint16_t* xpostag_ids;
+    const uint16_t* feats_ids;
+    const uint16_t* deprel_ids;
+    const uint32_t* starts;      // UTF-8 byte offsets, as udpipe_token.start / end
+    const uint32_t* ends;
+    const uint16_t* flags;       // UDPIPE_TOKEN_* bits
+    const char* forms;
+    const uint32_t* form_offsets;  // token_count + 1 entries
+    const char* lemmas;
+    const uint32_t* lemma_offsets; // token_count + 1 entries
+    // Sentence j holds tokens sentence_offsets[j] up to sentence_offsets[j + 1];
+    // udpipe_doc_view.count + 1 entries.
+    const uint32_t* sentence_offsets;
+} udpipe_columns;
+
+// A document is one flat token array with sentences as ranges into it. The sentence
+// views, the tokens and their strings are all carved out of the document's arena, so
+// releasing the document frees a handful of arena blocks rather than one allocation
+// per sentence.
 typedef struct {
     udpipe_sentence_view* sentences;
     size_t count;
     udpipe_arena_t arena; // Internal memory arena for this document
+    udpipe_token* tokens; // all tokens of the document, sentence after sentence
+    size_t token_count;
+    // With UDPIPE_OUTPUT_COLUMNS, the tokens as columns (and `sentences` and `tokens`
+    // are NULL); otherwise NULL.
+    const udpipe_columns* columns;
+    int status;               // UDPIPE_DOC_*
+    // For UDPIPE_DOC_PARTIAL and UDPIPE_DOC_FAILED, the first error the document ran
+    // into; owned by the document. NULL for UDPIPE_DOC_OK.
+    const char* error;
+    size_t skipped_sentences; // sentences dropped by UDPIPE_SKIP_BAD_SENTENCES
 } udpipe_doc_view;
 
 // Tag text and return structured sentences/tokens. If do_parse != 0, also run the parser
@@ -67,9 +258,19 @@ typedef struct {
 int udpipe_tag_structured(udpipe_model_t model, const char* utf8_text, int do_parse,
                           udpipe_doc_view* out_doc);
 
+// Process `text_len` bytes of UTF-8 text (which need not be NUL-terminated) with the
+// stages and options in `flags` (UDPIPE_STAGE_*, UDPIPE_BORROW_FORMS,
+// UDPIPE_OUTPUT_COLUMNS, UDPIPE_WANT_*). Returns 1 on success, 0 on failure.
+int udpipe_tag_structured_ex(udpipe_model_t model, const char* utf8_text, size_t text_len,
+                             unsigned int flags, udpipe_doc_view* out_doc);
+
 // Release memory allocated inside udpipe_tag_structured.
 void udpipe_free_doc(udpipe_doc_view* doc);
 
+// Like udpipe_free_doc, but keep the document's memory for reuse by later calls (see
+// "Arena pool" below) instead of returning it to the system.
+void udpipe_doc_recycle(udpipe_doc_view* doc);
+
 // Tag a batch of texts in parallel and return an array of structured documents.
 // The caller is responsible for freeing the `out_docs` array and its contents
 // by calling `udpipe_free_batch`.
@@ -77,15 +278,318 @@ void udpipe_free_doc(udpipe_doc_view* doc);
 int udpipe_tag_batch(udpipe_model_t model, const char** utf8_texts, size_t batch_size, int do_parse,
                      udpipe_doc_view** out_docs, size_t* out_size);
 
-// Release memory for a batch of documents allocated by `udpipe_tag_batch`.
+// Opaque handle for a persistent pool of worker threads.
+typedef void* udpipe_pool_t;
+
+// Create a pool of `num_threads` long-lived worker threads; 0 selects the number of
+// hardware threads. Idle workers sleep until work is submitted. Returns NULL on failure.
+udpipe_pool_t udpipe_pool_create(size_t num_threads);
+
+// Release a pool created by udpipe_pool_create. No batch call may be using it; queued
+// asynchronous batches are run to completion first.
+void udpipe_pool_free(udpipe_pool_t pool);
+
+// Number of worker threads owned by the pool.
+size_t udpipe_pool_size(udpipe_pool_t pool);
+
+// Worker placement
+// ----------------
+// On multi-socket machines, workers that migrate between sockets read the model and
+// their documents through remote memory. A pool can instead be confined to a set of
+// CPUs, pin each worker to one CPU, and group its workers by NUMA node: each node's
+// workers then take new documents from a queue of their own, and help other nodes only
+// when they run out of local work. Placement needs Linux; elsewhere, pinning is
+// skipped and the machine counts as a single node.
+enum {
+    UDPIPE_POOL_PIN_THREADS = 1 << 0, // pin each worker to one CPU
+    UDPIPE_POOL_NUMA = 1 << 1,        // group workers by NUMA node, confined to their node
+};
+
+typedef struct {
+    // Worker count; 0 selects one per CPU the pool may use.
+    size_t num_threads;
+    // CPUs the pool may use; NULL (and 0) for every CPU the process may run on.
+    const int* cpus;
+    size_t cpu_count;
+    // With UDPIPE_POOL_NUMA, use only the first `max_nodes` nodes that have usable
+    // CPUs; 0 for all of them.
+    size_t max_nodes;
+    unsigned int flags; // UDPIPE_POOL_*
+} udpipe_pool_options;
+
+// Create a pool placed according to `options`. With UDPIPE_POOL_NUMA, workers are
+// shared out between the nodes in proportion to their CPUs. Returns NULL if no CPU
+// is usable or the threads cannot be started.
+udpipe_pool_t udpipe_pool_create_ex(const udpipe_pool_options* options);
+
+// Number of NUMA nodes the pool's workers are grouped by (1 unless UDPIPE_POOL_NUMA).
+size_t udpipe_pool_node_count(udpipe_pool_t pool);
+
+// Number of NUMA nodes with CPUs the process may run on.
+size_t udpipe_numa_node_count(void);
+
+// Give every node of a UDPIPE_POOL_NUMA pool its own copy of `model`. A model's decoded
+// weights live in the memory of the node it was loaded on; each copy is decoded again
+// from the model's file on its node and takes as much memory as the original.
+// Batch calls on any grouped pool then tokenize, tag and parse with the copy of the
+// worker's node. Copies are kept until the model is freed. Only models loaded from a file
+// can be copied. Returns 1 once every node has a copy, 0 on failure.
+int udpipe_model_replicate(udpipe_model_t model, udpipe_pool_t pool);
+
+// Same as `udpipe_tag_batch`, but runs on the given worker pool. `udpipe_tag_batch`
+// itself uses a process-wide pool that is created on first use.
+int udpipe_tag_batch_pool(udpipe_model_t model, udpipe_pool_t pool, const char** utf8_texts,
+                          size_t batch_size, int do_parse,
+                          udpipe_doc_view** out_docs, size_t* out_size);
+
+// Batch counterpart of `udpipe_tag_structured_ex`. `pool` may be NULL to use the
+// process-wide pool and `text_lens` may be NULL for NUL-terminated texts. Like the other
+// batch calls it fails as a whole if any document fails, unless `flags` includes
+// UDPIPE_PARTIAL_BATCH.
+int udpipe_tag_batch_ex(udpipe_model_t model, udpipe_pool_t pool, const char** utf8_texts,
+                        const size_t* text_lens, size_t batch_size, unsigned int flags,
+                        udpipe_doc_view** out_docs, size_t* out_size);
+
+// Like `udpipe_tag_structured_ex`, but spreads one document over the worker pool (NULL
+// for the process-wide pool), for long inputs where single-threaded latency matters.
+// One task tokenizes and hands runs of sentences to the workers as it goes (the calling
+// thread works too); when the workers fall behind, it tags sentences itself rather than
+// queueing more, and sentences are marshalled in order as they complete. The result, including every
+// offset, is identical to `udpipe_tag_structured_ex`. Returns 1 on success, 0 on failure.
+int udpipe_tag_structured_parallel(udpipe_model_t model, udpipe_pool_t pool, const char* utf8_text,
+                                   size_t text_len, unsigned int flags, udpipe_doc_view* out_doc);
+
+// Called once per document of an asynchronous batch, from a pool worker thread, as soon as
+// the document is finished; documents of one batch may complete in any order and
+// concurrently. `ok` is 0 if this document failed; `doc` then only carries `status` and
+// `error`. Either way the callback owns `*doc`: it releases it with udpipe_doc_recycle
+// or udpipe_free_doc (copying the struct first if it keeps the document past the call).
+typedef void (*udpipe_doc_callback)(void* context, size_t index, int ok, udpipe_doc_view* doc);
+
+// Start tagging a batch like `udpipe_tag_batch_ex` without waiting for it. Returns 1 once
+// the work is queued and 0 if it could not be started, in which case `on_document` is
+// never called. Documents fail independently instead of failing the whole batch. The
+// `utf8_texts` array may be reused on return, but the texts themselves must stay valid
+// until the last callback.
+int udpipe_tag_batch_async(udpipe_model_t model, udpipe_pool_t pool, const char** utf8_texts,
+                           const size_t* text_lens, size_t batch_size, unsigned int flags,
+                           udpipe_doc_callback on_document, void* context);
+
+// Release memory for a batch of documents allocated by `udpipe_tag_batch`. The array
+// itself comes from malloc: a caller that takes over the documents one by one releases
+// each with udpipe_free_doc or udpipe_doc_recycle, and then the array with free().
 void udpipe_free_batch(udpipe_doc_view* docs, size_t batch_size);
 
+// Like udpipe_free_batch, but recycle each document as udpipe_doc_recycle does.
+void udpipe_batch_recycle(udpipe_doc_view* docs, size_t batch_size);
+
+// Arena pool
+// ----------
+// Documents are allocated from arenas of power-of-two blocks (8 KiB to 1 MiB) sized after
+// the documents recently processed on the same thread. Recycled blocks are kept on
+// per-thread freelists, with a bounded shared freelist behind them, so steady traffic
+// stops going through malloc. Counters cover the whole process.
+typedef struct {
+    uint64_t bytes_in_use; // blocks held by live documents and streams
+    uint64_t high_water;   // the largest bytes_in_use seen
+    uint64_t bytes_cached; // idle blocks kept for reuse
+} udpipe_arena_pool_stats;
+
+void udpipe_arena_pool_get_stats(udpipe_arena_pool_stats* out_stats);
+
+// Return every idle block, on all threads, to the system.
+void udpipe_arena_pool_trim(void);
+
 // Tokenize-only: build sentences and tokens with offsets, but no POS/parsing.
 // `tokenizer_options` can be NULL or an empty string for defaults.
 int udpipe_tokenize_structured(udpipe_model_t model, const char* utf8_text,
                                const char* tokenizer_options,
                                udpipe_doc_view* out_doc);
 
+// Tokenize-only batches
+// ---------------------
+// Tokenization yields only forms and offsets, so tokenize-only batches return a
+// leaner record than udpipe_token, without id, head or the empty tag fields.
+typedef struct {
+    const char* form; // surface form; NULL if borrowed (see UDPIPE_BORROW_FORMS)
+    size_t start;     // UTF-8 byte start offset in input (0 if unavailable)
+    size_t end;       // UTF-8 byte end offset (exclusive; 0 if unavailable)
+    uint32_t flags;   // UDPIPE_TOKEN_* bits
+} udpipe_plain_token;
+
+typedef struct {
+    udpipe_plain_token* tokens; // all tokens of the document, sentence after sentence
+    size_t token_count;
+    // `count + 1` entries: sentence i is tokens [sentence_offsets[i], sentence_offsets[i + 1]).
+    const size_t* sentence_offsets;
+    size_t count;          // number of sentences
+    udpipe_arena_t arena;  // owns the arrays and copied forms
+    int status;            // UDPIPE_DOC_OK or UDPIPE_DOC_FAILED
+    const char* error;     // for UDPIPE_DOC_FAILED, why; owned by the document
+} udpipe_token_doc;
+
+// Tokenize a batch of texts in parallel, one document per worker task, on `pool` (NULL
+// for the process-wide pool). `text_lens` may be NULL for NUL-terminated texts and
+// `tokenizer_options` NULL or empty for defaults. `flags` accepts UDPIPE_BORROW_FORMS and
+// UDPIPE_PARTIAL_BATCH. Release the result with `udpipe_free_token_batch`.
+// Returns 1 on success, 0 on failure.
+int udpipe_tokenize_batch(udpipe_model_t model, udpipe_pool_t pool, const char** utf8_texts,
+                          const size_t* text_lens, size_t batch_size, const char* tokenizer_options,
+                          unsigned int flags, udpipe_token_doc** out_docs, size_t* out_size);
+
+// Release a batch returned by `udpipe_tokenize_batch`: every document, then the array.
+void udpipe_free_token_batch(udpipe_token_doc* docs, size_t batch_size);
+
+// Like udpipe_free_token_batch, but keep the documents' memory for reuse (see "Arena pool").
+void udpipe_token_batch_recycle(udpipe_token_doc* docs, size_t batch_size);
+
+// Binary documents
+// ----------------
+// A compact, versioned serialisation of a processed document for passing results between
+// processes without formatting and re-parsing CoNLL-U: varint-encoded tokens, a per-document
+// table for each tag field and NUL-terminated strings, all in one contiguous buffer. The
+// layout is described in binary_format.h.
+
+// Process `text_len` bytes of UTF-8 text with the stages in `flags` (UDPIPE_STAGE_*; the
+// output options are ignored) and serialise the result into `*out_buffer`, which the caller
+// releases with udpipe_binary_free. Returns 1 on success, 0 on failure.
+int udpipe_tag_binary(udpipe_model_t model, const char* utf8_text, size_t text_len, unsigned int flags,
+                      char** out_buffer, size_t* out_len);
+
+// Wrap a serialised document as a doc view, to be released with udpipe_free_doc. Strings
+// point into `buffer`, which must outlive the view and stay unchanged; only the token and
+// sentence arrays are allocated. Tag ids index the document's own tables rather than a
+// model vocabulary. Returns 1 on success, 0 if the buffer is malformed or of an unknown
+// version.
+int udpipe_binary_open(const char* buffer, size_t len, udpipe_doc_view* out_doc);
+
+// Release a buffer returned by udpipe_tag_binary.
+void udpipe_binary_free(char* buffer);
+
+// Sessions
+// --------
+// A session caches the tokenizer, the working sentence and the marshalling buffers of
+// one model so that repeated calls skip their setup. A session is not thread-safe; use
+// one per thread. The model must outlive every session created from it.
+typedef void* udpipe_session_t;
+
+
+// Create a session for `model`. `tokenizer_options` can be NULL or an empty string for
+// defaults. Returns NULL on failure.
+udpipe_session_t udpipe_session_create(udpipe_model_t model, const char* tokenizer_options);
+
+// Release a session created by udpipe_session_create.
+void udpipe_session_free(udpipe_session_t session);
+
+// Process `text_len` bytes of UTF-8 text with the stages and options in `flags` and
+// return structured sentences/tokens, to be released with udpipe_free_doc.
+// Returns 1 on success, 0 on failure.
+int udpipe_session_process(udpipe_session_t session, const char* utf8_text, size_t text_len,
+                           unsigned int flags, udpipe_doc_view* out_doc);
+
+// Streaming
+// ---------
+// A stream tags a document one sentence at a time, on demand. Only the current sentence
+// is held in memory, so memory use is bounded by the longest sentence rather than the
+// length of the document, and the first sentence is available right away. A stream is
+// not thread-safe. The model must outlive the stream.
+//
+// The text either comes in one caller-owned buffer (udpipe_stream_open), or is fed in
+// chunks (udpipe_stream_create + udpipe_stream_feed) or read from a file descriptor
+// (udpipe_stream_open_fd). With chunked input, a sentence may span any number of chunks
+// and chunks may split UTF-8 sequences; token offsets count bytes from the start of the
+// stream. Chunked streams copy their input, so they ignore UDPIPE_BORROW_FORMS. A
+// sentence still unfinished after 256 KiB of chunked input is cut where the input
+// available so far ends, so text without sentence boundaries keeps memory use bounded.
+typedef void* udpipe_stream_t;
+
+// Results of udpipe_stream_next.
+enum {
+    UDPIPE_STREAM_ERROR = -1,     // failure; the stream only returns this from now on
+    UDPIPE_STREAM_END = 0,        // all input has been processed
+    UDPIPE_STREAM_SENTENCE = 1,   // a sentence was produced
+    UDPIPE_STREAM_NEED_INPUT = 2, // feed more input (or finish the stream) and call again
+};
+
+// Open a stream over `text_len` bytes of UTF-8 text, processed with the stages and
+// options in `flags`. The text is not copied and must stay valid until the stream is
+// closed. `tokenizer_options` can be NULL or an empty string for defaults.
+// Returns NULL on failure.
+udpipe_stream_t udpipe_stream_open(udpipe_model_t model, const char* utf8_text, size_t text_len,
+                                   const char* tokenizer_options, unsigned int flags);
+
+// Create a stream whose text is passed in with udpipe_stream_feed. Returns NULL on failure.
+udpipe_stream_t udpipe_stream_create(udpipe_model_t model, const char* tokenizer_options,
+                                     unsigned int flags);
+
+// Create a stream that reads its text from `fd` until end of file, blocking in
+// udpipe_stream_next when it needs more input. The descriptor is not closed by the
+// stream. Returns NULL on failure.
+udpipe_stream_t udpipe_stream_open_fd(udpipe_model_t model, int fd, const char* tokenizer_options,
+                                      unsigned int flags);
+
+// Append `chunk_len` bytes to a stream created by udpipe_stream_create. The chunk is
+// copied. Returns 1 on success, 0 on failure.
+int udpipe_stream_feed(udpipe_stream_t stream, const char* utf8_chunk, size_t chunk_len);
+
+// Mark the end of the input of a stream created by udpipe_stream_create, so that the
+// sentence in progress is completed. Returns 1 on success, 0 on failure.
+int udpipe_stream_finish(udpipe_stream_t stream);
+
+// Process the next sentence into `out_sentence`. Its `offset` is the index of its first
+// token within the stream. The sentence and its strings stay valid until the next call on
+// the stream, which recycles their memory. Returns one of UDPIPE_STREAM_*.
+int udpipe_stream_next(udpipe_stream_t stream, udpipe_sentence_view* out_sentence);
+
+// Release a stream opened by one of the functions above.
+void udpipe_stream_close(udpipe_stream_t stream);
+
+// Instrumentation
+// ---------------
+// When the wrapper is compiled with UDPIPE_STATS defined (set UDPIPE_STATS=1 when
+// building the package), each thread times the stages below and counts sentences, tokens
+// and arena bytes; the snapshot sums all threads. Without it, no timing code is compiled
+// in and the snapshot reports zeros.
+enum {
+    UDPIPE_STAT_TOKENIZE = 0, // input_format::next_sentence
+    UDPIPE_STAT_TAG,          // model::tag, per sentence
+    UDPIPE_STAT_PARSE,        // model::parse, per sentence
+    UDPIPE_STAT_MARSHAL,      // copying sentences into udpipe_doc_view / udpipe_sentence_view
+    UDPIPE_STAT_CONVERT,      // converting results on the caller's side (udpipe_stats_record)
+    UDPIPE_STAT_STAGE_COUNT
+};
+
+// Histogram bucket i counts durations in [2^i, 2^(i+1)) nanoseconds; bucket 0 also holds
+// zero-length ones and the last bucket everything longer.
+#define UDPIPE_STATS_BUCKETS 32
+
+typedef struct {
+    uint64_t count;    // timed calls
+    uint64_t total_ns; // their summed duration
+    uint64_t histogram[UDPIPE_STATS_BUCKETS];
+} udpipe_stage_stats;
+
+typedef struct {
+    udpipe_stage_stats stages[UDPIPE_STAT_STAGE_COUNT]; // indexed by UDPIPE_STAT_*
+    uint64_t sentences;   // sentences marshalled into results
+    uint64_t tokens;      // tokens marshalled into results
+    uint64_t arena_bytes; // bytes of document and stream arena blocks allocated
+} udpipe_stats;
+
+// 1 if the wrapper was compiled with UDPIPE_STATS, 0 otherwise.
+int udpipe_stats_enabled(void);
+
+// Fill `out_stats` with everything counted since start-up or the last udpipe_stats_reset.
+// Returns 1 on success, 0 if instrumentation is compiled out (`out_stats` is zeroed).
+int udpipe_stats_snapshot(udpipe_stats* out_stats);
+
+// Start counting from zero again, for all threads.
+void udpipe_stats_reset(void);
+
+// Add a duration measured by the caller to `stage` on the calling thread, e.g. the time a
+// language binding spends converting a udpipe_doc_view. No-op when compiled out.
+void udpipe_stats_record(int stage, uint64_t nanoseconds);
+
 #ifdef __cplusplus
 }
 #endif
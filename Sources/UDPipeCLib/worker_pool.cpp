@@ -0,0 +1,328 @@
+#include "worker_pool.h"
+
+#include "cpu_topology.h"
+
+#include <algorithm>
+#include <exception>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+// Identifies the pool worker running on the current thread, if any.
+thread_local const WorkerPool* current_pool = nullptr;
+thread_local size_t current_index = 0;
+thread_local int current_numa_node = -1;
+} // namespace
+
+WorkerPool::WorkerPool(size_t num_threads) {
+    if (num_threads == 0) num_threads = std::thread::hardware_concurrency();
+    if (num_threads == 0) num_threads = 1;
+
+    Group all;
+    all.worker_count = num_threads;
+    groups_.push_back(all);
+    worker_group_.assign(num_threads, 0);
+    worker_cpus_.resize(num_threads);
+    start(num_threads);
+}
+
+WorkerPool::WorkerPool(const Options& options) {
+    start(place_workers(options));
+}
+
+size_t WorkerPool::place_workers(const Options& options) {
+    // The usable CPUs, grouped by node in node order.
+    std::vector<Group> candidates;
+    for (const auto& node : cpu_topology::nodes()) {
+        Group g;
+        g.node = node.id;
+        for (int cpu : node.cpus) {
+            if (options.cpus.empty() || std::count(options.cpus.begin(), options.cpus.end(), cpu)) {
+                g.cpus.push_back(cpu);
+            }
+        }
+        if (g.cpus.empty()) continue;
+        candidates.push_back(std::move(g));
+        if (options.numa && options.max_nodes && candidates.size() == options.max_nodes) break;
+    }
+    if (candidates.empty()) throw std::invalid_argument("no usable CPU");
+    if (!options.numa) {
+        Group all;
+        for (auto& g : candidates) all.cpus.insert(all.cpus.end(), g.cpus.begin(), g.cpus.end());
+        candidates.assign(1, std::move(all));
+    }
+    std::vector<int> cpus; // candidate CPUs, node after node
+    for (const auto& g : candidates) cpus.insert(cpus.end(), g.cpus.begin(), g.cpus.end());
+
+    const bool confine = options.pin || options.numa || !options.cpus.empty();
+    size_t num_threads = options.num_threads;
+    if (num_threads == 0) num_threads = confine ? cpus.size() : std::thread::hardware_concurrency();
+    if (num_threads == 0) num_threads = 1;
+
+    // Worker i takes CPU i * cpus / workers: groups get workers in proportion to
+    // their CPUs, in contiguous ranges. Without grouping, fill the CPUs in order
+    // instead, so a small pool stays on the first node.
+    std::vector<size_t> group_of_cpu;
+    for (size_t g = 0; g < candidates.size(); ++g) {
+        group_of_cpu.insert(group_of_cpu.end(), candidates[g].cpus.size(), g);
+    }
+    for (size_t i = 0; i < num_threads; ++i) {
+        const size_t slot = options.numa ? i * cpus.size() / num_threads : i % cpus.size();
+        const size_t g = group_of_cpu[slot];
+        if (candidates[g].worker_count++ == 0) candidates[g].first_worker = i;
+        worker_group_.push_back(g);
+        if (options.pin) worker_cpus_.push_back({cpus[slot]});
+        else if (confine) worker_cpus_.push_back(candidates[g].cpus);
+        else worker_cpus_.emplace_back();
+    }
+
+    // Drop groups that got no worker, renumbering the rest.
+    std::vector<size_t> renumbered(candidates.size());
+    for (size_t g = 0; g < candidates.size(); ++g) {
+        renumbered[g] = groups_.size();
+        if (candidates[g].worker_count) groups_.push_back(std::move(candidates[g]));
+    }
+    for (auto& g : worker_group_) g = renumbered[g];
+    if (!confine) groups_[0].cpus.clear();
+    return num_threads;
+}
+
+void WorkerPool::start(size_t num_threads) {
+    queues_.reserve(num_threads + groups_.size());
+    for (size_t i = 0; i < num_threads + groups_.size(); ++i) {
+        queues_.push_back(std::make_unique<WorkQueue>());
+    }
+    for (size_t g = 0; g < groups_.size(); ++g) {
+        bound_queues_.push_back(std::make_unique<WorkQueue>());
+        sleepers_.push_back(std::make_unique<Sleepers>());
+    }
+
+    workers_.reserve(num_threads);
+    try {
+        for (size_t i = 0; i < num_threads; ++i) {
+            workers_.emplace_back([this, i]() { worker_loop(i); });
+        }
+    } catch (...) {
+        { std::lock_guard<std::mutex> lock(sleep_mutex_); stopping_ = true; }
+        wake_all();
+        for (auto& t : workers_) t.join();
+        throw;
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    wait(background_);
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stopping_ = true;
+    }
+    wake_all();
+    for (auto& t : workers_) {
+        t.join();
+    }
+}
+
+void WorkerPool::submit(TaskGroup& group, std::function<void()> task) {
+    size_t index = current_pool == this ? current_index : workers_.size();
+    size_t target = index < workers_.size() ? worker_group_[index] : 0;
+    if (index == workers_.size() && groups_.size() > 1) {
+        target = next_injection_.fetch_add(1, std::memory_order_relaxed) % groups_.size();
+        index += target;
+    }
+    {
+        WorkQueue& q = *queues_[index];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        q.tasks.push_back(Task{&group, std::move(task)});
+        // Counted only once queued, so a push that throws leaves the group as it was;
+        // nobody can pop the task before the count is raised while we hold the lock.
+        group.pending_.fetch_add(1);
+        group.queued_.fetch_add(1);
+        queued_.fetch_add(1);
+    }
+
+    // Taking the sleep mutex orders this wake-up after any sleeper's predicate check.
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    wake_worker(target);
+    if (waiters_.load() != 0) done_cv_.notify_all();
+}
+
+void WorkerPool::submit_to_group(size_t g, TaskGroup& group, std::function<void()> task) {
+    if (g >= groups_.size()) throw std::out_of_range("no such worker group");
+    {
+        WorkQueue& q = *bound_queues_[g];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        q.tasks.push_back(Task{&group, std::move(task)});
+        group.pending_.fetch_add(1); // as in `submit`
+        sleepers_[g]->bound.fetch_add(1);
+    }
+
+    // Only the group's own workers can take the task, so wake one of them.
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    Sleepers& sleepers = *sleepers_[g];
+    if (sleepers.sleeping > sleepers.woken) {
+        ++sleepers.woken;
+        sleepers.cv.notify_one();
+    }
+    if (waiters_.load() != 0) done_cv_.notify_all();
+}
+
+bool WorkerPool::wait(TaskGroup& group) {
+    size_t index = current_pool == this ? current_index : workers_.size();
+    // Tasks bound to the calling worker's group, which it runs too (see take_task).
+    const std::atomic<size_t>* bound = index < workers_.size() ? &sleepers_[worker_group_[index]]->bound : nullptr;
+    Task task;
+    while (group.pending_.load() != 0) {
+        if (take_task(index, task, &group)) {
+            run_task(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        waiters_.fetch_add(1);
+        done_cv_.wait(lock, [&]() {
+            return group.pending_.load() == 0 || group.queued_.load() != 0 ||
+                   (bound != nullptr && bound->load() != 0);
+        });
+        waiters_.fetch_sub(1);
+    }
+    return group.failed_.load() == 0;
+}
+
+WorkerPool& WorkerPool::shared() {
+    static WorkerPool pool(0);
+    return pool;
+}
+
+int WorkerPool::current_node() {
+    return current_numa_node;
+}
+
+void WorkerPool::worker_loop(size_t index) {
+    current_pool = this;
+    current_index = index;
+    current_numa_node = groups_[worker_group_[index]].node;
+    if (!worker_cpus_[index].empty()) cpu_topology::pin_current_thread(worker_cpus_[index]);
+
+    Task task;
+    for (;;) {
+        if (take_task(index, task)) {
+            run_task(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        Sleepers& sleepers = *sleepers_[worker_group_[index]];
+        ++sleepers.sleeping;
+        sleepers.cv.wait(lock, [&]() { return stopping_ || queued_.load() != 0 || sleepers.bound.load() != 0; });
+        --sleepers.sleeping;
+        if (sleepers.woken) --sleepers.woken;
+        if (stopping_ && queued_.load() == 0 && sleepers.bound.load() == 0) return;
+    }
+}
+
+bool WorkerPool::pop(size_t queue, bool newest, Task& task, const TaskGroup* only) {
+    WorkQueue& q = *queues_[queue];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty()) return false;
+    if (only) {
+        // The newest (or oldest) task of the group, wherever it sits in the queue.
+        auto matches = [only](const Task& t) { return t.group == only; };
+        auto it = q.tasks.end();
+        if (newest) {
+            auto last = std::find_if(q.tasks.rbegin(), q.tasks.rend(), matches);
+            if (last != q.tasks.rend()) it = std::prev(last.base());
+        } else {
+            it = std::find_if(q.tasks.begin(), q.tasks.end(), matches);
+        }
+        if (it == q.tasks.end()) return false;
+        task = std::move(*it);
+        q.tasks.erase(it);
+    } else if (newest) {
+        task = std::move(q.tasks.back());
+        q.tasks.pop_back();
+    } else {
+        task = std::move(q.tasks.front());
+        q.tasks.pop_front();
+    }
+    task.group->queued_.fetch_sub(1);
+    queued_.fetch_sub(1);
+    return true;
+}
+
+bool WorkerPool::pop_bound(size_t g, Task& task) {
+    WorkQueue& q = *bound_queues_[g];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty()) return false;
+    task = std::move(q.tasks.front());
+    q.tasks.pop_front();
+    sleepers_[g]->bound.fetch_sub(1);
+    return true;
+}
+
+bool WorkerPool::take_from_group(size_t g, size_t after, Task& task, const TaskGroup* only) {
+    const Group& group = groups_[g];
+    if (pop(workers_.size() + g, false, task, only)) return true;
+    const bool member = after >= group.first_worker && after < group.first_worker + group.worker_count;
+    const size_t offset = member ? after - group.first_worker + 1 : 0;
+    for (size_t k = 0; k < group.worker_count; ++k) {
+        const size_t victim = group.first_worker + (offset + k) % group.worker_count;
+        if (victim != after && pop(victim, false, task, only)) return true;
+    }
+    return false;
+}
+
+bool WorkerPool::take_task(size_t index, Task& task, const TaskGroup* only) {
+    // Own queue newest-first, which keeps a document's sentences hot in this
+    // worker's cache; then tasks bound to this group, and new outside work for
+    // it; then steal the oldest task of the group's other workers, starting
+    // with the next one over; and only then go to the other groups, i.e. other
+    // NUMA nodes.
+    // worker_group_ is complete before the first worker starts; workers_ may still be growing.
+    const size_t workers = worker_group_.size();
+    const size_t own = index < workers ? worker_group_[index] : 0;
+    const bool bound = index < workers && sleepers_[own]->bound.load() != 0;
+    if (!bound && (only ? only->queued_.load() : queued_.load()) == 0) return false;
+    if (index < workers && pop(index, true, task, only)) return true;
+    // Bound tasks can only run here, so a worker in `wait` takes them whichever task group they belong to.
+    if (bound && pop_bound(own, task)) return true;
+    for (size_t k = 0; k < groups_.size(); ++k) {
+        if (take_from_group((own + k) % groups_.size(), index, task, only)) return true;
+    }
+    return false;
+}
+
+void WorkerPool::wake_worker(size_t g) {
+    for (size_t k = 0; k < sleepers_.size(); ++k) {
+        Sleepers& sleepers = *sleepers_[(g + k) % sleepers_.size()];
+        if (sleepers.sleeping > sleepers.woken) {
+            ++sleepers.woken;
+            sleepers.cv.notify_one();
+            return;
+        }
+    }
+}
+
+void WorkerPool::wake_all() {
+    for (auto& sleepers : sleepers_) sleepers->cv.notify_all();
+}
+
+void WorkerPool::run_task(Task& task) {
+    TaskGroup* group = task.group;
+    // Tasks report their own failures. One that throws anyway is recorded
+    // against its group for `wait` to report, and still counts as finished, so
+    // neither the worker nor the group's waiter is lost. Nobody waits on
+    // background tasks, so debug builds stop there instead.
+    try {
+        task.fn();
+    } catch (...) {
+#ifndef NDEBUG
+        if (group == &background_) std::terminate();
+#endif
+        group->failed_.fetch_add(1);
+    }
+    task.fn = nullptr;
+    if (group->pending_.fetch_sub(1) == 1) {
+        // Waiters check `pending_` under the sleep mutex, so notifying while
+        // holding it cannot race with a waiter that is about to park.
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        done_cv_.notify_all();
+    }
+}
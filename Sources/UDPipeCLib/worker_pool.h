@@ -0,0 +1,173 @@
+#pragma once
+
+// Internal C++ helper shared by the wrapper translation units.
+// Not part of the C interface exported through module.modulemap.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A long-lived pool of worker threads.
+//
+// Work is submitted as tasks belonging to a TaskGroup; `wait` blocks until every
+// task of the group has run. Each worker owns a deque: tasks submitted from a
+// worker (e.g. the per-sentence jobs a document task fans out into) go to the
+// back of that worker's deque and are run LIFO, while idle workers steal from
+// the front of other deques. Tasks submitted from outside the pool go to a
+// shared injection queue. Idle workers park on a condition variable, so a pool
+// that has nothing to do costs no CPU.
+//
+// Workers can be confined to a set of CPUs, pinned one per CPU, and grouped by
+// NUMA node. Each group has its own injection queue, which outside submissions
+// take turns filling, and a worker looks for work in its group (its own deque,
+// the group's queue, then its neighbours) before it turns to other groups. A
+// document is then usually tokenized, tagged and marshalled on one node.
+class WorkerPool {
+public:
+    // Tracks the tasks submitted for one unit of work (e.g. a batch call).
+    class TaskGroup {
+        friend class WorkerPool;
+        std::atomic<size_t> pending_{0};
+        std::atomic<size_t> queued_{0}; // tasks of the group still sitting in a queue
+        std::atomic<size_t> failed_{0}; // tasks of the group that threw
+    };
+
+    struct Options {
+        // 0 selects one worker per CPU in `cpus` (or per usable CPU) when any
+        // placement option is set, and `std::thread::hardware_concurrency()` otherwise.
+        size_t num_threads = 0;
+        // CPUs the workers may run on; empty for every usable CPU. Workers are
+        // confined to these even without `pin`.
+        std::vector<int> cpus;
+        // Pin each worker to a single CPU.
+        bool pin = false;
+        // Group workers by NUMA node (see the class comment) and confine each to its node.
+        bool numa = false;
+        // With `numa`, use only the first `max_nodes` nodes that have CPUs in `cpus`; 0 for all.
+        size_t max_nodes = 0;
+    };
+
+    // Workers of one NUMA node (or, without grouping, all of them).
+    struct Group {
+        int node = -1;         // NUMA node id; -1 for a pool that isn't grouped
+        std::vector<int> cpus; // CPUs the group covers; empty if the pool isn't confined
+        size_t first_worker = 0;
+        size_t worker_count = 0;
+    };
+
+    // Starts `num_threads` workers; 0 selects `std::thread::hardware_concurrency()`.
+    explicit WorkerPool(size_t num_threads);
+    // Starts workers placed according to `options`. Throws std::invalid_argument
+    // if `options.cpus` names no usable CPU.
+    explicit WorkerPool(const Options& options);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    size_t size() const { return workers_.size(); }
+
+    const std::vector<Group>& groups() const { return groups_; }
+
+    // The NUMA node of the pool worker running on the calling thread, if that
+    // pool groups its workers by node; -1 otherwise.
+    static int current_node();
+
+    // Queue `task` for execution on one of the workers. May be called from a
+    // running task to fan out more work into the same or another group. If the
+    // task can't be queued this throws and `group` is left unchanged. A task
+    // should handle its own errors: one that throws anyway still counts as
+    // finished, and is recorded against its group for `wait` to report.
+    void submit(TaskGroup& group, std::function<void()> task);
+
+    // As `submit`, but `task` runs on a worker of group `g` (an index into
+    // `groups()`), e.g. to touch memory on that NUMA node. Other workers don't
+    // steal it, and `wait` runs it only when called from a worker of `g`, which
+    // then runs such tasks of any task group. Throws std::out_of_range for a
+    // group the pool doesn't have.
+    void submit_to_group(size_t g, TaskGroup& group, std::function<void()> task);
+
+    // Block until every task submitted to `group` has finished. While tasks of
+    // the group are still queued the calling thread runs them itself; it never
+    // runs other groups' tasks (but see submit_to_group), so a caller is not
+    // held up by unrelated work.
+    // Returns false if any task of the group threw.
+    bool wait(TaskGroup& group);
+
+    // Queue `task` in the pool's own group, for work nobody waits on (e.g. an
+    // asynchronous batch). The destructor drains these tasks before stopping.
+    void submit_background(std::function<void()> task) { submit(background_, std::move(task)); }
+
+    // Process-wide pool used when the caller does not provide one.
+    static WorkerPool& shared();
+
+private:
+    struct Task {
+        TaskGroup* group;
+        std::function<void()> fn;
+    };
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    // Where the workers of one group park while there is nothing to run; guarded
+    // by sleep_mutex_. `woken` counts wake-ups not yet taken up, so that once every
+    // sleeper of a group has been claimed, further work wakes another group.
+    // `bound` counts the tasks in the group's bound queue (see submit_to_group),
+    // which only its own workers wake up for.
+    struct Sleepers {
+        std::condition_variable cv;
+        size_t sleeping = 0;
+        size_t woken = 0;
+        std::atomic<size_t> bound{0};
+    };
+
+    // Works out groups_, worker_group_ and worker_cpus_ for `options`, and
+    // returns the number of workers to start.
+    size_t place_workers(const Options& options);
+    void start(size_t num_threads);
+    void worker_loop(size_t index);
+    // Pops the next task for the worker `index` (or for an outside thread when
+    // `index == size()`): own queue first, then its group's injection queue and
+    // the group's other workers, then the other groups.
+    // With `only`, takes only tasks of that task group.
+    bool take_task(size_t index, Task& task, const TaskGroup* only = nullptr);
+    // Pops from the injection queue of group `g`, then steals from its workers,
+    // starting after worker `after` (when it belongs to the group).
+    bool take_from_group(size_t g, size_t after, Task& task, const TaskGroup* only);
+    bool pop(size_t queue, bool newest, Task& task, const TaskGroup* only);
+    // Pops the oldest task from the bound queue of group `g`.
+    bool pop_bound(size_t g, Task& task);
+    void run_task(Task& task);
+    // Wakes a parked worker of group `g`, or of another group if `g` has none left.
+    // Requires sleep_mutex_.
+    void wake_worker(size_t g);
+    void wake_all();
+
+    std::vector<std::thread> workers_;
+    // One queue per worker, followed by one injection queue per group at index
+    // `size() + group`.
+    std::vector<std::unique_ptr<WorkQueue>> queues_;
+    // One queue per group for submit_to_group; tasks there are not counted in `queued_`.
+    std::vector<std::unique_ptr<WorkQueue>> bound_queues_;
+    std::vector<Group> groups_;
+    std::vector<size_t> worker_group_;            // group of each worker
+    std::vector<std::vector<int>> worker_cpus_;   // affinity of each worker; empty for none
+    std::atomic<size_t> next_injection_{0};       // group the next outside submission goes to
+    std::atomic<size_t> queued_{0};   // tasks sitting in any queue
+    std::atomic<size_t> waiters_{0};  // threads blocked in `wait`
+
+    std::mutex sleep_mutex_;
+    std::vector<std::unique_ptr<Sleepers>> sleepers_; // one per group
+    std::condition_variable done_cv_; // `wait` parks here until its group drains or gets more work
+    bool stopping_ = false;
+    TaskGroup background_;
+};
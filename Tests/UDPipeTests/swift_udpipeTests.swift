@@ -1,3 +1,4 @@
+import Foundation
 import Testing
 @testable import UDPipe
 
@@ -37,3 +38,301 @@ import Testing
         #expect(false, "Failed to get tagged tokens")
     }
 }
+
+@Test func sessionMatchesOneShotCalls() async throws {
+    let modelPath = "/Users/george/Documents/ML/swift-udpipe/english-ewt-ud-2.5-191206.udpipe"
+    let text = "Hello world. This is a UDPipe tagging demo."
+
+    let udpipe = try UDPipe(modelPath: modelPath)
+    let session = try UDPipe.Session(udpipe: udpipe)
+
+    // Repeated calls reuse the same tokenizer and must keep producing identical output.
+    for _ in 0..<3 {
+        let tagged = session.tagTokens(text)
+        #expect(tagged.count == 2)
+        #expect(tagged.map { $0.map(\.form) } == udpipe.tagTokens(text).map { $0.map(\.form) })
+        #expect(session.tokenize(text).flatMap(\.tokens).count == 10)
+    }
+}
+
+@Test func binaryDocumentsRoundTrip() async throws {
+    let modelPath = "/Users/george/Documents/ML/swift-udpipe/english-ewt-ud-2.5-191206.udpipe"
+    let text = "Hello world. This is a UDPipe tagging demo."
+
+    let udpipe = try UDPipe(modelPath: modelPath)
+    let bytes = try #require(udpipe.tagBinary(text))
+    let decoded = try #require(UDPipe.decodeBinary(bytes))
+    let direct = udpipe.tagTokens(text)
+
+    #expect(decoded.map { $0.map(\.form) } == direct.map { $0.map(\.form) })
+    #expect(decoded.map { $0.map(\.lemma) } == direct.map { $0.map(\.lemma) })
+    #expect(decoded.map { $0.map(\.head) } == direct.map { $0.map(\.head) })
+    #expect(decoded.map { $0.map(\.start) } == direct.map { $0.map(\.start) })
+    #expect(UDPipe.decodeBinary(Array(bytes.dropLast())) == nil)
+}
+
+@Test func lazyDocumentsMatchEagerConversion() async throws {
+    let modelPath = "/Users/george/Documents/ML/swift-udpipe/english-ewt-ud-2.5-191206.udpipe"
+    let texts = ["Hello world. This is a UDPipe tagging demo.", "", "Another one."]
+
+    let udpipe = try UDPipe(modelPath: modelPath)
+    let eager = udpipe.tagTokens(batch: texts)
+    let lazy = udpipe.tagDocuments(batch: texts)
+
+    #expect(lazy.count == texts.count)
+    for (doc, expected) in zip(lazy, eager) {
+        #expect(doc.map { $0.map(\.form) } == expected.map { $0.map(\.form) })
+        #expect(doc.map { $0.map(\.pos) } == expected.map { $0.map(\.pos) })
+        #expect(doc.taggedTokens.map { $0.map(\.lemma) } == expected.map { $0.map(\.lemma) })
+    }
+    #expect(udpipe.tagDocument(texts[0]).map { $0.map(\.start) } == eager[0].map { $0.map(\.start) })
+}
+
+@Test func asyncBatchingMatchesSynchronousTagging() async throws {
+    let modelPath = "/Users/george/Documents/ML/swift-udpipe/english-ewt-ud-2.5-191206.udpipe"
+    let texts = (0..<20).map { "Request number \($0). It has two sentences." }
+
+    let udpipe = try UDPipe(modelPath: modelPath)
+    let expected = udpipe.tagTokens(batch: texts)
+    let batched = await udpipe.tagTokensAsync(batch: texts)
+    #expect(batched.map { $0.map { $0.map(\.lemma) } } == expected.map { $0.map { $0.map(\.lemma) } })
+
+    let queue = UDPipe.TaggingQueue(udpipe: udpipe, maxBatchSize: 8, maxInFlight: 4)
+    let queued = await withTaskGroup(of: (Int, [[UDPipe.TaggedToken]]).self) { group in
+        for (i, text) in texts.enumerated() {
+            group.addTask { (i, await queue.tag(text)) }
+        }
+        var out = Array(repeating: [[UDPipe.TaggedToken]](), count: texts.count)
+        for await (i, sentences) in group { out[i] = sentences }
+        return out
+    }
+    #expect(queued.map { $0.map { $0.map(\.head) } } == expected.map { $0.map { $0.map(\.head) } })
+}
+
+@Test func batchTokenizationMatchesSingleTexts() async throws {
+    let modelPath = "/Users/george/Documents/ML/swift-udpipe/english-ewt-ud-2.5-191206.udpipe"
+    let texts = ["Hello world. This is a UDPipe tagging demo.", "", "Don't stop."]
+
+    let udpipe = try UDPipe(modelPath: modelPath)
+    let batched = udpipe.tokenize(batch: texts)
+
+    #expect(batched.count == texts.count)
+    for (sentences, text) in zip(batched, texts) {
+        let single = udpipe.tokenize(text)
+        #expect(sentences.map { $0.tokens.map(\.text) } == single.map { $0.tokens.map(\.text) })
+        #expect(sentences.map { $0.tokens.map(\.end) } == single.map { $0.tokens.map(\.end) })
+    }
+}
+
+@Test func fieldSelectionLeavesOtherFieldsEmpty() async throws {
+    let modelPath = "/Users/george/Documents/ML/swift-udpipe/english-ewt-ud-2.5-191206.udpipe"
+    let text = "Hello world. This is a UDPipe tagging demo."
+
+    let udpipe = try UDPipe(modelPath: modelPath)
+    let full = udpipe.tagTokens(text)
+    let upos = udpipe.tagTokens(text, fields: .upos)
+
+    #expect(upos.map { $0.map(\.pos) } == full.map { $0.map(\.pos) })
+    #expect(upos.allSatisfy { $0.allSatisfy { $0.lemma.isEmpty && $0.head == nil } })
+    let deps = udpipe.tagTokens(text, fields: [.lemma, .dependencies])
+    #expect(deps.map { $0.map(\.head) } == full.map { $0.map(\.head) })
+
+    // The session and asynchronous entry points honour the selection the same way.
+    let session = try UDPipe.Session(udpipe: udpipe)
+    #expect(session.tagTokens(text, fields: .upos).map { $0.map(\.pos) } == upos.map { $0.map(\.pos) })
+    let batched = await udpipe.tagTokensAsync(batch: [text, text], fields: .upos)
+    #expect(batched.allSatisfy { $0.map { $0.map(\.pos) } == upos.map { $0.map(\.pos) } })
+    #expect(batched.allSatisfy { $0.allSatisfy { $0.allSatisfy { $0.lemma.isEmpty && $0.head == nil } } })
+    let queue = UDPipe.TaggingQueue(udpipe: udpipe, fields: .upos)
+    #expect(await queue.tag(text).allSatisfy { $0.allSatisfy { $0.lemma.isEmpty && $0.head == nil } })
+}
+
+@Test func numaAwarePoolMatchesDefaultPool() async throws {
+    let modelPath = "/Users/george/Documents/ML/swift-udpipe/english-ewt-ud-2.5-191206.udpipe"
+    let texts = (0..<32).map { "Document \($0) is short. It still has two sentences." }
+
+    let udpipe = try UDPipe(modelPath: modelPath)
+    let pool = try UDPipe.WorkerPool(pinThreads: true, numaAware: true)
+    #expect(pool.nodeCount >= 1 && pool.nodeCount <= UDPipe.WorkerPool.numaNodeCount)
+    #expect(udpipe.replicate(on: pool))
+
+    let expected = udpipe.tagTokens(batch: texts)
+    let placed = udpipe.tagTokens(batch: texts, pool: pool)
+    #expect(placed.map { $0.map { $0.map(\.head) } } == expected.map { $0.map { $0.map(\.head) } })
+}
+
+@Test func fileStreamMatchesInMemoryStream() async throws {
+    let modelPath = "/Users/george/Documents/ML/swift-udpipe/english-ewt-ud-2.5-191206.udpipe"
+    let udpipe = try UDPipe(modelPath: modelPath)
+
+    // Short sentences with two-byte characters, then one sentence long enough to span
+    // several 64 KiB reads. The padding puts the lead byte of an "é" last in the first
+    // read, so its continuation byte arrives with the next one.
+    var body = ""
+    for i in 0..<3_000 { body += "Café número \(i) está aquí. " }
+    body += Array(repeating: "word", count: 40_000).joined(separator: " ") + ".\n"
+    let leads = body.utf8.enumerated().filter { $0.offset <= 65_535 && $0.element >= 0xC0 }
+    let text = String(repeating: " ", count: 65_535 - leads.last!.offset) + body
+
+    let url = FileManager.default.temporaryDirectory.appendingPathComponent("udpipe-stream-\(getpid()).txt")
+    try Data(text.utf8).write(to: url)
+    defer { try? FileManager.default.removeItem(at: url) }
+
+    var expected: [[UDPipe.TaggedToken]] = []
+    for try await sentence in udpipe.sentences(text, doParse: false) { expected.append(sentence) }
+    var streamed: [[UDPipe.TaggedToken]] = []
+    for try await sentence in udpipe.sentences(contentsOfFile: url.path, doParse: false) { streamed.append(sentence) }
+
+    #expect(expected.count == 3_001)
+    #expect(streamed.map { $0.map(\.form) } == expected.map { $0.map(\.form) })
+    #expect(streamed.map { $0.map(\.start) } == expected.map { $0.map(\.start) })
+    #expect(streamed.map { $0.map(\.end) } == expected.map { $0.map(\.end) })
+}
+
+@Test func registryDeduplicatesReloadsAndEvicts() async throws {
+    let modelPath = "/Users/george/Documents/ML/swift-udpipe/english-ewt-ud-2.5-191206.udpipe"
+    let directory = FileManager.default.temporaryDirectory.appendingPathComponent("udpipe-registry-\(getpid())")
+    try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true)
+    defer { try? FileManager.default.removeItem(at: directory) }
+    let pathA = directory.appendingPathComponent("a.udpipe").path
+    let pathB = directory.appendingPathComponent("b.udpipe").path
+    try FileManager.default.copyItem(atPath: modelPath, toPath: pathA)
+    try FileManager.default.copyItem(atPath: modelPath, toPath: pathB)
+    let fileSize = try #require(FileManager.default.attributesOfItem(atPath: pathA)[.size] as? Int)
+
+    // Room for one model only.
+    let registry = try UDPipe.ModelRegistry(memoryBudget: fileSize + fileSize / 2)
+
+    // Concurrent first requests share one load.
+    let handles = try await withThrowingTaskGroup(of: UnsafeMutableRawPointer.self) { group in
+        for _ in 0..<8 { group.addTask { try registry.model(at: pathA).handle } }
+        return try await group.reduce(into: [UnsafeMutableRawPointer]()) { $0.append($1) }
+    }
+    #expect(Set(handles).count == 1)
+    #expect(registry.count == 1 && registry.memoryUsage == fileSize)
+
+    // A changed file keeps serving the loaded model until the reload swaps in a new one.
+    let old = try registry.model(at: pathA)
+    try FileManager.default.setAttributes([.modificationDate: Date(timeIntervalSinceNow: 60)], ofItemAtPath: pathA)
+    #expect(try registry.model(at: pathA).handle == old.handle)
+    var reloaded = old
+    for _ in 0..<600 where reloaded.handle == old.handle {
+        try await Task.sleep(nanoseconds: 100_000_000)
+        reloaded = try registry.model(at: pathA)
+    }
+    #expect(reloaded.handle != old.handle)
+    #expect(old.tagTokens("Hello world.").first?.map(\.form) == reloaded.tagTokens("Hello world.").first?.map(\.form))
+
+    // Loading a second model goes over the budget and drops the least recently used one.
+    _ = try registry.model(at: pathB)
+    #expect(registry.count == 1 && registry.memoryUsage == fileSize)
+}
+
+@Test func sentenceCacheHitsMatchUncachedOutput() async throws {
+    let modelPath = "/Users/george/Documents/ML/swift-udpipe/english-ewt-ud-2.5-191206.udpipe"
+    let text = "The meeting starts at noon. Please bring your badge. The meeting starts at noon."
+    let udpipe = try UDPipe(modelPath: modelPath)
+
+    func annotations(_ sentences: [[UDPipe.TaggedToken]]) -> [String] {
+        sentences.flatMap { $0 }.map {
+            "\($0.form) \($0.lemma) \($0.pos.rawValue) \($0.xpostag ?? "-") \($0.features) " +
+                "\($0.head ?? -1) \($0.deprel?.rawValue ?? "-") \($0.start)-\($0.end)"
+        }
+    }
+
+    let uncached = annotations(udpipe.tagTokens(text))
+    udpipe.setSentenceCache(capacity: 1)
+    #expect(annotations(udpipe.tagTokens(text)) == uncached)
+    // Capacity is exact: the cache never holds more sentences than it was given room for.
+    #expect(udpipe.sentenceCacheStatistics.entries == 1)
+
+    udpipe.setSentenceCache(capacity: 100)
+    let first = annotations(udpipe.tagTokens(text))
+    let second = annotations(udpipe.tagTokens(text))
+    let stats = udpipe.sentenceCacheStatistics
+    #expect(first == uncached && second == uncached)
+    #expect(stats.misses == 2 && stats.hits == 4 && stats.entries == 2)
+}
+
+// Needs the fault injection hook, which only debug builds compile in.
+#if UDPIPE_TESTING
+@Test func batchStatusReportsFailedAndPartialDocuments() async throws {
+    let modelPath = "/Users/george/Documents/ML/swift-udpipe/english-ewt-ud-2.5-191206.udpipe"
+    let udpipe = try UDPipe(modelPath: modelPath)
+    udpipe._failOnForm("Zzyzx")
+    defer { udpipe._failOnForm(nil) }
+
+    let texts = ["Hello world. This is fine.", "The road to Zzyzx is long. It is hot.", "All good here."]
+
+    // Without skipping, only the document with the bad sentence fails.
+    let results = udpipe.tagTokensWithStatus(batch: texts)
+    #expect(results.count == 3)
+    #expect(results[0].status == .ok && results[0].sentences.count == 2)
+    #expect(results[1].status == .failed(error: "injected failure") && results[1].sentences.isEmpty)
+    #expect(results[2].status == .ok && results[2].sentences.count == 1)
+    #expect(results[0].sentences.map { $0.map(\.form) } == udpipe.tagTokens(texts[0]).map { $0.map(\.form) })
+
+    // With skipping, the bad sentence is left out and counted.
+    let skipped = udpipe.tagTokensWithStatus(batch: texts, skipBadSentences: true)
+    #expect(skipped[0].status == .ok && skipped[2].status == .ok)
+    #expect(skipped[1].status == .partial(skippedSentences: 1, error: "injected failure"))
+    #expect(skipped[1].sentences.map { $0.map(\.form) } == [["It", "is", "hot", "."]])
+}
+#endif
+
+@Test func parallelDocumentMatchesSerialCall() async throws {
+    let modelPath = "/Users/george/Documents/ML/swift-udpipe/english-ewt-ud-2.5-191206.udpipe"
+    let udpipe = try UDPipe(modelPath: modelPath)
+    let text = (0..<200).map { "Sentence \($0) walks a different dog to the park." }.joined(separator: " ")
+
+    func annotations(_ sentences: [[UDPipe.TaggedToken]]) -> [String] {
+        sentences.flatMap { $0 }.map {
+            "\($0.id) \($0.form) \($0.lemma) \($0.pos.rawValue) \($0.xpostag ?? "-") \($0.features) " +
+                "\($0.head ?? -1) \($0.deprel?.rawValue ?? "-") \($0.start)-\($0.end)"
+        }
+    }
+
+    let serial = udpipe.tagTokens(text)
+    #expect(serial.count == 200)
+    // 25 chunks of 8 sentences: with one worker, at most 4 are queued and the tokenizer
+    // tags the rest inline, so both the stolen and the inline paths are taken.
+    for threads in [1, 4] {
+        let pool = try UDPipe.WorkerPool(threadCount: threads)
+        #expect(annotations(udpipe.tagTokens(text, pool: pool)) == annotations(serial))
+    }
+}
+
+@Test func parseOutputMatchesGolden() async throws {
+    let modelPath = "/Users/george/Documents/ML/swift-udpipe/english-ewt-ud-2.5-191206.udpipe"
+    let udpipe = try UDPipe(modelPath: modelPath)
+    let text = """
+        The quick brown fox jumped over the lazy dog near the riverbank. She didn't know whether \
+        the 3 committees would approve Dr. Smith's proposal by Friday! Why, asked the children, \
+        were the old books, maps and letters hidden under the stairs? Profits rose 4.5% in 2019, \
+        while costs fell sharply.
+        """
+
+    // Lemma, UPOS, head and relation of every token, one line each; sentences end with a blank line.
+    let output = udpipe.tagTokens(text, doParse: true).map { sentence in
+        sentence.map {
+            "\($0.form)\t\($0.lemma)\t\($0.pos.rawValue)\t\($0.head ?? -1)\t\($0.deprel?.rawValue ?? "-")\n"
+        }.joined() + "\n"
+    }.joined()
+
+    // The portable debug build (`swift test`) records the golden file when it is missing; commit
+    // it. Release and UDPIPE_NATIVE_ARCH=1 builds then check that their output is the same.
+    // Kept outside the test target's directory, so SwiftPM doesn't treat it as a source.
+    let golden = URL(fileURLWithPath: #filePath).deletingLastPathComponent().deletingLastPathComponent()
+        .appendingPathComponent("Golden/parse-output.tsv")
+    guard let expected = try? String(contentsOf: golden, encoding: .utf8) else {
+        #if UDPIPE_OPTIMIZED_CORE
+        Issue.record("Missing \(golden.path); record it first with a portable debug build (`swift test`).")
+        #else
+        try FileManager.default.createDirectory(at: golden.deletingLastPathComponent(),
+                                                withIntermediateDirectories: true)
+        try output.write(to: golden, atomically: true, encoding: .utf8)
+        #endif
+        return
+    }
+    #expect(output == expected)
+}